@@ -2,15 +2,9 @@
 #include <stdlib.h>
 #include <locale.h>
 
-#define PAGE_SIZE 20
+#include "record.h"
 
-typedef struct record
-{
-    char depositor[31];     // ФИО вкладчика (30 символов + 1 на '\0')
-    unsigned short amount;  // Сумма вклада (unsigned short int)
-    char date[11];          // Дата вклада (10 символов + 1 на '\0')
-    char lawyer[23];        // ФИО адвоката (22 символа + 1 на '\0')
-} record;
+#define PAGE_SIZE 20
 
 int main()
 {
@@ -24,10 +18,23 @@ int main()
         return 1;
     }
 
-    record DB[4000] = {0};
-    int total_records = fread(DB, sizeof(record), 4000, fp);
+    // Файл читается целиком одним fread и просматривается как массив record
+    fseek(fp, 0, SEEK_END);
+    long file_size = ftell(fp);
+    fseek(fp, 0, SEEK_SET);
+    char *data = (char *)malloc(file_size > 0 ? (size_t)file_size : 1);
+    if (data == NULL || file_size < 0) {
+        printf("Недостаточно памяти!\n");
+        fclose(fp);
+        return 1;
+    }
+    size_t data_size = fread(data, 1, (size_t)file_size, fp);
     fclose(fp);
 
+    record_view view = record_view_of(data, data_size);
+    const record *DB = view.records;
+    int total_records = (int)view.count;
+
     int page = 0;
     char command;
 
@@ -38,17 +45,20 @@ int main()
         int end = start + PAGE_SIZE;
         if (end > total_records) end = total_records;
         system("chcp 65001 > nul");
-        printf("%-30s %-6hu %-10s %-22s\n", 
+        printf("%-30s %-6s %-10s %-22s\n", 
                "Фио", "Сумма", "Дата", "Адвокат");
         printf("-------------------------------------------------------------------------------\n");
         system("chcp 866 > nul");
         for (int i = start; i < end; ++i)
         {
-            printf("%-32s %-18s %-6hd %-10hd\n", 
-                   DB[i].depositor, 
-                   DB[i].amount, 
-                   DB[i].date, 
-                   DB[i].lawyer);
+            field_view depositor = record_depositor(&DB[i]);
+            field_view date = record_date(&DB[i]);
+            field_view lawyer = record_lawyer(&DB[i]);
+            printf("%-30.*s %-6u %-10.*s %-22.*s\n", 
+                   (int)depositor.len, depositor.data, 
+                   record_amount(&DB[i]), 
+                   (int)date.len, date.data, 
+                   (int)lawyer.len, lawyer.data);
         }
         //setlocale(LC_ALL, "Russian");
         system("chcp 65001 > nul");
@@ -70,5 +80,6 @@ int main()
 
     } while (command != 'q' && command != 'Q');
 
+    free(data);
     return 0;
 }
\ No newline at end of file
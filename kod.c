@@ -1,93 +1,217 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <stdint.h>
 #include <math.h>
+#include <time.h>
 
-#define MAX_BLOCK_SIZE 1024
-#define PRECISION_BITS 52  // double имеет ~52 бита мантиссы
+// Целочисленный интервальный кодер (range coder): 32-битный интервал,
+// 64-битная нижняя граница для переноса, вывод по байту. Точность не
+// ограничивает длину блока, поэтому весь файл кодируется одним потоком.
+#define RC_TOTAL_BITS 16
+#define RC_TOTAL (1u << RC_TOTAL_BITS)   // Сумма частот модели
+#define RC_TOP (1u << 24)                // Ниже - нормализация интервала
 
 typedef struct {
-    unsigned char symbol;
-    double low;
-    double high;
-} SymbolRange;
+    uint32_t freq[256];     // Частоты символов, сумма RC_TOTAL
+    uint32_t start[256];    // Накопленные частоты
+    unsigned char symbol_of[RC_TOTAL];  // Символ по накопленной частоте
+    int num_symbols;
+} FreqModel;
 
-void calculate_frequencies(unsigned char *data, int len, double freq[256]) {
-    int i;
-    for (i = 0; i < 256; i++) freq[i] = 0.0;
-    for (i = 0; i < len; i++) freq[data[i]] += 1.0;
-    if (len > 0) {
-        for (i = 0; i < 256; i++) freq[i] /= (double)len;
+typedef struct {
+    uint64_t low;           // 33 бита: старший - перенос в уже выведенные байты
+    uint32_t range;
+    unsigned char cache;    // Последний байт, который ещё может получить перенос
+    uint64_t cache_size;    // cache и следующие за ним байты 0xFF
+    unsigned char *out;
+    size_t pos;
+} RangeEncoder;
+
+typedef struct {
+    uint32_t code;
+    uint32_t range;
+    const unsigned char *in;
+    size_t size;
+    size_t pos;
+} RangeDecoder;
+
+// Накопленные частоты и таблица символов по частотам model->freq
+void finish_model(FreqModel *model) {
+    uint32_t start = 0;
+    int s;
+    for (s = 0; s < 256; s++) {
+        model->start[s] = start;
+        for (uint32_t k = 0; k < model->freq[s]; k++) model->symbol_of[start + k] = (unsigned char)s;
+        start += model->freq[s];
     }
 }
 
-void build_intervals(double freq[256], SymbolRange intervals[256], int *num_symbols) {
-    int i, j = 0;
-    double cum_prob = 0.0;
-    *num_symbols = 0;
-    for (i = 0; i < 256; i++) {
-        if (freq[i] > 0.0) {
-            intervals[j].symbol = (unsigned char)i;
-            intervals[j].low = cum_prob;
-            cum_prob += freq[i];
-            intervals[j].high = cum_prob;
-            (*num_symbols)++;
-            j++;
+// Частоты байт, приведённые к сумме RC_TOTAL; у встреченного символа не меньше 1
+void build_model(const unsigned char *data, size_t len, FreqModel *model) {
+    uint64_t count[256] = {0};
+    size_t i;
+    int s;
+    for (i = 0; i < len; i++) count[data[i]]++;
+
+    uint32_t sum = 0;
+    model->num_symbols = 0;
+    for (s = 0; s < 256; s++) {
+        model->freq[s] = 0;
+        if (count[s] == 0) continue;
+        uint64_t f = count[s] * RC_TOTAL / len;
+        model->freq[s] = f > 0 ? (uint32_t)f : 1;
+        sum += model->freq[s];
+        model->num_symbols++;
+    }
+    // Остаток округления отдаём самым частым символам или забираем у них
+    while (len > 0 && sum != RC_TOTAL) {
+        int best = -1;
+        for (s = 0; s < 256; s++)
+            if ((sum < RC_TOTAL || model->freq[s] > 1) && (best < 0 || model->freq[s] > model->freq[best]))
+                best = s;
+        if (sum < RC_TOTAL) {
+            model->freq[best]++;
+            sum++;
+        } else {
+            model->freq[best]--;
+            sum--;
         }
     }
+    finish_model(model);
 }
 
-int find_symbol(SymbolRange intervals[], int num_symbols, double value) {
-    int i;
-    for (i = 0; i < num_symbols; i++) {
-        if (value >= intervals[i].low && value < intervals[i].high) {
-            return i;
-        }
+void rc_encoder_init(RangeEncoder *e, unsigned char *out) {
+    e->low = 0;
+    e->range = 0xFFFFFFFFu;
+    e->cache = 0;
+    e->cache_size = 1;
+    e->out = out;
+    e->pos = 0;
+}
+
+// Выводит старший байт low. Байт задерживается, пока перенос ещё может его
+// изменить: cache и цепочка 0xFF за ним выводятся, когда перенос известен.
+static void rc_shift_low(RangeEncoder *e) {
+    if ((uint32_t)e->low < 0xFF000000u || (e->low >> 32) != 0) {
+        unsigned char carry = (unsigned char)(e->low >> 32);
+        unsigned char temp = e->cache;
+        do {
+            e->out[e->pos++] = (unsigned char)(temp + carry);
+            temp = 0xFF;
+        } while (--e->cache_size != 0);
+        e->cache = (unsigned char)(e->low >> 24);
     }
-    return -1;
+    e->cache_size++;
+    e->low = (e->low & 0x00FFFFFFu) << 8;
 }
 
-double arithmetic_encode_block(unsigned char *block, int block_len, SymbolRange intervals[], int num_symbols) {
-    double low = 0.0, high = 1.0;
-    int i;
-    for (i = 0; i < block_len; i++) {
-        double range = high - low;
-        int sym_idx = -1;
-        for (int j = 0; j < num_symbols; j++) {
-            if (intervals[j].symbol == block[i]) {
-                sym_idx = j;
-                break;
-            }
-        }
-        if (sym_idx == -1) {
-            continue;
-        }
-        high = low + range * intervals[sym_idx].high;
-        low = low + range * intervals[sym_idx].low;
-        printf("Блок %d: Интервал [%.6f, %.6f), Символ (код=%u, hex=%02X)\n",
-               i + 1, low, high, block[i], block[i]);
+static inline void rc_encode(RangeEncoder *e, uint32_t start, uint32_t size) {
+    uint32_t r = e->range >> RC_TOTAL_BITS;
+    e->low += (uint64_t)r * start;
+    e->range = r * size;
+    while (e->range < RC_TOP) {
+        e->range <<= 8;
+        rc_shift_low(e);
     }
-    return (low + high) / 2.0;
 }
 
-void arithmetic_decode_block(double code, int block_len, SymbolRange intervals[], int num_symbols, unsigned char *decoded) {
-    double low = 0.0, high = 1.0;
+// Возвращает размер потока
+size_t rc_flush(RangeEncoder *e) {
     int i;
-    for (i = 0; i < block_len; i++) {
-        double range = high - low;
-        double value = (code - low) / range;
-        int sym_idx = find_symbol(intervals, num_symbols, value);
-        if (sym_idx == -1) {
-            decoded[i] = 0; // или 0xFF — неизвестный символ
-            printf("Декодировано: неизвестный символ (код=???) (Интервал [%.6f, %.6f))\n", low, high);
-            continue;
-        }
-        decoded[i] = intervals[sym_idx].symbol;
-        printf("Декодировано: код=%u (hex=%02X) (Интервал [%.6f, %.6f))\n",
-               decoded[i], decoded[i], low, high);
-        high = low + range * intervals[sym_idx].high;
-        low = low + range * intervals[sym_idx].low;
+    for (i = 0; i < 5; i++) rc_shift_low(e);
+    return e->pos;
+}
+
+static inline unsigned char rc_next_byte(RangeDecoder *d) {
+    return d->pos < d->size ? d->in[d->pos++] : 0;
+}
+
+void rc_decoder_init(RangeDecoder *d, const unsigned char *in, size_t size) {
+    int i;
+    d->code = 0;
+    d->range = 0xFFFFFFFFu;
+    d->in = in;
+    d->size = size;
+    d->pos = 0;
+    for (i = 0; i < 5; i++) d->code = (d->code << 8) | rc_next_byte(d);
+}
+
+static inline unsigned char rc_decode(RangeDecoder *d, const FreqModel *model) {
+    uint32_t r = d->range >> RC_TOTAL_BITS;
+    uint32_t value = d->code / r;
+    if (value >= RC_TOTAL) value = RC_TOTAL - 1;    // Только в испорченном потоке
+    unsigned char symbol = model->symbol_of[value];
+    d->code -= r * model->start[symbol];
+    d->range = r * model->freq[symbol];
+    while (d->range < RC_TOP) {
+        d->code = (d->code << 8) | rc_next_byte(d);
+        d->range <<= 8;
+    }
+    return symbol;
+}
+
+// Поток не длиннее 2 байт на символ (частота не меньше 1/RC_TOTAL) плюс хвост
+size_t arithmetic_encode(const unsigned char *data, size_t len, const FreqModel *model, unsigned char *out) {
+    RangeEncoder e;
+    size_t i;
+    rc_encoder_init(&e, out);
+    for (i = 0; i < len; i++) rc_encode(&e, model->start[data[i]], model->freq[data[i]]);
+    return rc_flush(&e);
+}
+
+void arithmetic_decode(const unsigned char *in, size_t size, size_t len, const FreqModel *model, unsigned char *decoded) {
+    RangeDecoder d;
+    size_t i;
+    rc_decoder_init(&d, in, size);
+    for (i = 0; i < len; i++) decoded[i] = rc_decode(&d, model);
+}
+
+static double seconds_now(void) {
+    struct timespec ts;
+    timespec_get(&ts, TIME_UTC);
+    return (double)ts.tv_sec + (double)ts.tv_nsec / 1e9;
+}
+
+// Заголовок encoded.bin: длина файла (8 байт), число символов - 1 (1 байт),
+// для каждого символа байт и частота - 1 (2 байта); все числа little-endian
+static size_t write_header(FILE *fp, size_t len, const FreqModel *model) {
+    unsigned char header[8 + 1 + 256 * 3];
+    size_t n = 0;
+    int s;
+    for (s = 0; s < 8; s++) header[n++] = (unsigned char)((uint64_t)len >> (8 * s));
+    header[n++] = (unsigned char)(model->num_symbols > 0 ? model->num_symbols - 1 : 0);
+    for (s = 0; s < 256; s++) {
+        if (model->freq[s] == 0) continue;
+        header[n++] = (unsigned char)s;
+        header[n++] = (unsigned char)((model->freq[s] - 1) & 0xFF);
+        header[n++] = (unsigned char)((model->freq[s] - 1) >> 8);
     }
+    return fwrite(header, 1, n, fp) == n ? n : 0;
+}
+
+static int read_header(const unsigned char *data, size_t size, size_t *len, FreqModel *model, size_t *header_len) {
+    size_t n = 0;
+    uint64_t total = 0;
+    int s, num_symbols;
+    if (size < 9) return -1;
+    for (s = 0; s < 8; s++) total |= (uint64_t)data[n++] << (8 * s);
+    num_symbols = total > 0 ? data[n] + 1 : 0;    // Пустой файл - без таблицы
+    n++;
+    if (size < n + 3 * (size_t)num_symbols) return -1;
+    memset(model->freq, 0, sizeof(model->freq));
+    for (s = 0; s < num_symbols; s++) {
+        model->freq[data[n]] = 1 + (data[n + 1] | ((uint32_t)data[n + 2] << 8));
+        n += 3;
+    }
+    uint32_t sum = 0;
+    for (s = 0; s < 256; s++) sum += model->freq[s];
+    if (total > 0 && sum != RC_TOTAL) return -1;
+    model->num_symbols = num_symbols;
+    finish_model(model);
+    *len = (size_t)total;
+    *header_len = n;
+    return 0;
 }
 
 void lab11() {
@@ -101,138 +225,115 @@ void lab11() {
     long file_size = ftell(input_file);
     rewind(input_file);
 
-    if (file_size < 1024) {
-        printf("Файл должен быть не менее 1024 байт. Текущий размер: %ld\n", file_size);
+    unsigned char *file_data = (unsigned char *)malloc(file_size > 0 ? file_size : 1);
+    unsigned char *stream = (unsigned char *)malloc(2 * (size_t)file_size + 16);
+    if (!file_data || !stream || fread(file_data, 1, file_size, input_file) != (size_t)file_size) {
+        printf("Ошибка чтения input.txt\n");
         fclose(input_file);
+        free(file_data);
+        free(stream);
         return;
     }
-
-    unsigned char *file_data = (unsigned char *)malloc(file_size);
-    fread(file_data, 1, file_size, input_file);
     fclose(input_file);
 
-    // Найти максимальный безопасный размер блока
-    int max_safe_block_size = 1;
-    double freq[256];
-    SymbolRange intervals[256];
-    int num_symbols;
-
-    for (int block_size = 1; block_size <= MAX_BLOCK_SIZE && block_size <= file_size; block_size++) {
-        calculate_frequencies(file_data, block_size, freq);
-        build_intervals(freq, intervals, &num_symbols);
-
-        double encoded_val = arithmetic_encode_block(file_data, block_size, intervals, num_symbols);
-
-        unsigned char *decoded_block = (unsigned char *)malloc(block_size);
-        arithmetic_decode_block(encoded_val, block_size, intervals, num_symbols, decoded_block);
-
-        int match = 1;
-        for (int i = 0; i < block_size; i++) {
-            if (file_data[i] != decoded_block[i]) {
-                match = 0;
-                break;
-            }
-        }
-        free(decoded_block);
-
-        if (match) {
-            max_safe_block_size = block_size;
-        } else {
-            break;
+    // Модель нулевого порядка по всему файлу и её энтропия
+    static FreqModel model;
+    build_model(file_data, (size_t)file_size, &model);
+    double entropy = 0.0;
+    {
+        uint64_t count[256] = {0};
+        long i;
+        int s;
+        for (i = 0; i < file_size; i++) count[file_data[i]]++;
+        for (s = 0; s < 256; s++) {
+            if (count[s] == 0) continue;
+            double p = (double)count[s] / (double)file_size;
+            entropy -= (double)count[s] * log2(p);
         }
     }
 
-    printf("\nМаксимальный размер блока без потери точности: %d байт\n", max_safe_block_size);
+    // Кодирование всего файла одним потоком
+    double t0 = seconds_now();
+    size_t stream_len = arithmetic_encode(file_data, (size_t)file_size, &model, stream);
+    double encode_time = seconds_now() - t0;
 
-    // Кодирование всего файла
     FILE *encoded_file = fopen("encoded.bin", "wb");
     if (!encoded_file) {
         printf("Ошибка создания encoded.bin\n");
         free(file_data);
+        free(stream);
         return;
     }
-
-    int total_blocks = (file_size + max_safe_block_size - 1) / max_safe_block_size;
-
-    for (int i = 0; i < total_blocks; i++) {
-        int start = i * max_safe_block_size;
-        int block_len = (start + max_safe_block_size <= file_size) ? max_safe_block_size : (int)(file_size - start);
-        unsigned char *block = file_data + start;
-
-        calculate_frequencies(block, block_len, freq);
-        build_intervals(freq, intervals, &num_symbols);
-
-        double code_val = arithmetic_encode_block(block, block_len, intervals, num_symbols);
-
-        fwrite(&block_len, sizeof(int), 1, encoded_file);
-        fwrite(&num_symbols, sizeof(int), 1, encoded_file);
-        for (int j = 0; j < num_symbols; j++) {
-            fwrite(&intervals[j].symbol, sizeof(unsigned char), 1, encoded_file);
-            fwrite(&intervals[j].low, sizeof(double), 1, encoded_file);
-            fwrite(&intervals[j].high, sizeof(double), 1, encoded_file);
-        }
-        fwrite(&code_val, sizeof(double), 1, encoded_file);
+    size_t header_len = write_header(encoded_file, (size_t)file_size, &model);
+    int write_ok = header_len > 0 && fwrite(stream, 1, stream_len, encoded_file) == stream_len;
+    if (fclose(encoded_file) != 0 || !write_ok) {
+        printf("Ошибка записи encoded.bin\n");
+        free(file_data);
+        free(stream);
+        return;
     }
-
-    fclose(encoded_file);
+    free(stream);
 
     // Декодирование
     FILE *decode_in = fopen("encoded.bin", "rb");
     FILE *decoded_file = fopen("decoded.txt", "wb");
     if (!decode_in || !decoded_file) {
         printf("Ошибка открытия файлов для декодирования\n");
+        if (decode_in) fclose(decode_in);
+        if (decoded_file) fclose(decoded_file);
         free(file_data);
         return;
     }
-
-    for (int i = 0; i < total_blocks; i++) {
-        int block_len, num_syms;
-        fread(&block_len, sizeof(int), 1, decode_in);
-        fread(&num_syms, sizeof(int), 1, decode_in);
-
-        SymbolRange dec_intervals[256];
-        for (int j = 0; j < num_syms; j++) {
-            fread(&dec_intervals[j].symbol, sizeof(unsigned char), 1, decode_in);
-            fread(&dec_intervals[j].low, sizeof(double), 1, decode_in);
-            fread(&dec_intervals[j].high, sizeof(double), 1, decode_in);
-        }
-
-        double code_val;
-        fread(&code_val, sizeof(double), 1, decode_in);
-
-        unsigned char *decoded_block = (unsigned char *)malloc(block_len);
-        arithmetic_decode_block(code_val, block_len, dec_intervals, num_syms, decoded_block);
-        fwrite(decoded_block, 1, block_len, decoded_file);
-        free(decoded_block);
+    fseek(decode_in, 0, SEEK_END);
+    long encoded_size = ftell(decode_in);
+    rewind(decode_in);
+    unsigned char *encoded = (unsigned char *)malloc(encoded_size > 0 ? encoded_size : 1);
+    static FreqModel dec_model;
+    size_t len = 0, dec_header_len = 0;
+    if (!encoded || fread(encoded, 1, encoded_size, decode_in) != (size_t)encoded_size ||
+        read_header(encoded, (size_t)encoded_size, &len, &dec_model, &dec_header_len) != 0) {
+        printf("Ошибка: encoded.bin повреждён\n");
+        fclose(decode_in);
+        fclose(decoded_file);
+        free(encoded);
+        free(file_data);
+        return;
     }
-
     fclose(decode_in);
-    fclose(decoded_file);
 
-    // Коэффициент сжатия
-    FILE *enc_f = fopen("encoded.bin", "rb");
-    fseek(enc_f, 0, SEEK_END);
-    long encoded_size = ftell(enc_f);
-    fclose(enc_f);
-
-    double compression_ratio = (double)encoded_size / file_size * 100.0;
-    printf("\nКоэффициент сжатия: %.2f%%\n", compression_ratio);
-
-    // Зависимость от длины блока
-    printf("\nЗависимость коэффициента сжатия от длины блока:\n");
-    for (int bs = 1; bs <= max_safe_block_size; bs += 10) {
-        if (bs > file_size) break;
-        calculate_frequencies(file_data, bs, freq);
-        build_intervals(freq, intervals, &num_symbols);
-        double enc_val = arithmetic_encode_block(file_data, bs, intervals, num_symbols);
-        // Оценка размера: блок_len (int) + num_sym (int) + sym table + double
-        long size_est = sizeof(int) + sizeof(int) +
-                        num_symbols * (sizeof(unsigned char) + 2 * sizeof(double)) +
-                        sizeof(double);
-        double ratio = (double)size_est / bs * 100.0;
-        printf("Блок %d байт: %.2f%%\n", bs, ratio);
+    unsigned char *decoded = (unsigned char *)malloc(len > 0 ? len : 1);
+    if (!decoded) {
+        printf("Ошибка: недостаточно памяти\n");
+        fclose(decoded_file);
+        free(encoded);
+        free(file_data);
+        return;
     }
+    t0 = seconds_now();
+    arithmetic_decode(encoded + dec_header_len, (size_t)encoded_size - dec_header_len, len, &dec_model, decoded);
+    double decode_time = seconds_now() - t0;
+    fwrite(decoded, 1, len, decoded_file);
+    fclose(decoded_file);
 
+    int match = len == (size_t)file_size && memcmp(decoded, file_data, len) == 0;
+    printf("Декодирование %s\n", match ? "совпадает с исходным файлом" : "НЕ совпадает с исходным файлом");
+
+    // Коэффициент сжатия в сравнении с энтропией
+    double entropy_bytes = entropy / 8.0;
+    printf("\nИсходный размер: %ld байт\n", file_size);
+    printf("Энтропия (нулевой порядок): %.4f бит/символ, %.0f байт\n",
+           file_size > 0 ? entropy / (double)file_size : 0.0, entropy_bytes);
+    printf("Сжатый поток: %zu байт (%.4f бит/символ), заголовок: %zu байт\n", stream_len,
+           file_size > 0 ? 8.0 * (double)stream_len / (double)file_size : 0.0, header_len);
+    printf("Коэффициент сжатия: %.2f%% (предел по энтропии %.2f%%)\n",
+           file_size > 0 ? (double)encoded_size / file_size * 100.0 : 0.0,
+           file_size > 0 ? entropy_bytes / file_size * 100.0 : 0.0);
+    printf("Скорость: кодирование %.1f МБ/с, декодирование %.1f МБ/с\n",
+           encode_time > 0 ? file_size / encode_time / 1e6 : 0.0,
+           decode_time > 0 ? file_size / decode_time / 1e6 : 0.0);
+
+    free(decoded);
+    free(encoded);
     free(file_data);
     printf("\nЛР11 завершена. Результаты: encoded.bin, decoded.txt\n");
 }
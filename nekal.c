@@ -1,6 +1,21 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <stdint.h>
+#include <time.h>
+#include <math.h>
+#include <pthread.h>
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <sys/types.h>
+#include <unistd.h>
+#endif
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#include <immintrin.h>
+#define HAVE_X86_SIMD 1
+#endif
 
 #define MAX_BITS 256
 
@@ -63,6 +78,22 @@ void code_elias_gamma(int n, char* result) {
     
     strcpy(&result[idx], mantissa);
 }
+
+void code_elias_delta(int n, char* result) {
+    if (n == 0) { strcpy(result, "-"); return; }
+    int full_len = get_full_bit_length(n);
+    char len_part[64];
+    code_elias_gamma(full_len, len_part);
+    char mantissa_part[33];
+    get_mantissa(n, full_len - 1, mantissa_part);
+
+    if (strlen(mantissa_part) == 0) {
+        strcpy(result, len_part);
+    } else {
+        sprintf(result, "%s %s", len_part, mantissa_part);
+    }
+}
+
 void code_elias_omega(int n, char* result) {
     if (n == 0) { strcpy(result, "-"); return; }
     
@@ -91,21 +122,1686 @@ void code_elias_omega(int n, char* result) {
     strcpy(result, buffer);
 }
 
-int main() {
+// ---- Упакованный битовый поток ----
+// Строковые функции выше годятся только для таблицы. Ниже те же коды
+// записываются в настоящий поток: биты идут от старшего к младшему (в том же
+// порядке, что и в строках), накапливаются в 64-битном регистре и выводятся
+// словами, а не по одному биту.
+
+typedef struct bit_writer
+{
+    uint8_t *out;
+    size_t pos;         // Записано байт
+    uint64_t acc;       // Младшие fill бит - ещё не выведенные биты
+    unsigned fill;      // Всегда меньше 32
+} bit_writer;
+
+void bw_init(bit_writer *w, uint8_t *out) {
+    w->out = out;
+    w->pos = 0;
+    w->acc = 0;
+    w->fill = 0;
+}
+
+// Дописывает bits (0..32) младших бит value; старшие биты value должны быть нулями
+static inline void bw_put(bit_writer *w, uint32_t value, unsigned bits) {
+    w->acc = (w->acc << bits) | value;
+    w->fill += bits;
+    if (w->fill >= 32) {
+        w->fill -= 32;
+        uint32_t word = (uint32_t)(w->acc >> w->fill);
+        uint8_t *p = w->out + w->pos;
+        p[0] = (uint8_t)(word >> 24);
+        p[1] = (uint8_t)(word >> 16);
+        p[2] = (uint8_t)(word >> 8);
+        p[3] = (uint8_t)word;
+        w->pos += 4;
+    }
+}
+
+size_t bw_bits(const bit_writer *w) {
+    return w->pos * 8 + w->fill;
+}
+
+// Выводит остаток, дополняя последний байт нулями; возвращает размер в байтах
+size_t bw_flush(bit_writer *w) {
+    while (w->fill >= 8) {
+        w->fill -= 8;
+        w->out[w->pos++] = (uint8_t)(w->acc >> w->fill);
+    }
+    if (w->fill > 0) w->out[w->pos++] = (uint8_t)(w->acc << (8 - w->fill));
+    w->fill = 0;
+    return w->pos;
+}
+
+typedef struct bit_reader
+{
+    const uint8_t *in;
+    size_t size;
+    size_t pos;         // Загружено в регистр байт
+    uint64_t acc;       // Старшие fill бит - ещё не прочитанные биты
+    unsigned fill;
+    unsigned pad;       // Нулевых бит добавлено за концом потока
+} bit_reader;
+
+void br_init(bit_reader *r, const uint8_t *in, size_t size) {
+    r->in = in;
+    r->size = size;
+    r->pos = 0;
+    r->acc = 0;
+    r->fill = 0;
+    r->pad = 0;
+}
+
+static inline uint64_t load_be64(const uint8_t *p) {
+    return ((uint64_t)p[0] << 56) | ((uint64_t)p[1] << 48) | ((uint64_t)p[2] << 40) |
+           ((uint64_t)p[3] << 32) | ((uint64_t)p[4] << 24) | ((uint64_t)p[5] << 16) |
+           ((uint64_t)p[6] << 8) | (uint64_t)p[7];
+}
+
+// После вызова в регистре не меньше 56 бит. Внутри потока читается сразу
+// 8 байт; биты за fill при этом либо нулевые, либо уже верные, поэтому
+// повторное OR тех же байт ничего не портит. За концом потока идут нули.
+static inline void br_refill(bit_reader *r) {
+    if (r->pos + 8 <= r->size) {
+        r->acc |= load_be64(r->in + r->pos) >> r->fill;
+        unsigned bytes = (63 - r->fill) >> 3;
+        r->pos += bytes;
+        r->fill += bytes * 8;
+    } else {
+        while (r->fill <= 56) {
+            uint64_t byte = 0;
+            if (r->pos < r->size) byte = r->in[r->pos++];
+            else r->pad += 8;
+            r->acc |= byte << (56 - r->fill);
+            r->fill += 8;
+        }
+    }
+}
+
+// Читает bits (0..32) бит; в регистре их должно быть не меньше
+static inline uint32_t br_get(bit_reader *r, unsigned bits) {
+    if (bits == 0) return 0;
+    uint32_t value = (uint32_t)(r->acc >> (64 - bits));
+    r->acc <<= bits;
+    r->fill -= bits;
+    return value;
+}
+
+// Прочитаны биты за концом потока
+int br_overrun(const bit_reader *r) {
+    return r->fill < r->pad;
+}
+
+// ---- Коды Элиаса над битовым потоком ----
+// Коды гамма, дельта и омега определены для чисел 1..2^32-1, код
+// "фиксированная + переменная часть" (4 бита длины) - для 0..32767.
+
+typedef enum elias_code
+{
+    CODE_FIXED_VARIABLE,
+    CODE_GAMMA,
+    CODE_DELTA,
+    CODE_OMEGA,
+    CODE_COUNT
+} elias_code;
+
+const char *elias_code_names[CODE_COUNT] = { "Fixed+Var", "Elias Gamma", "Elias Delta", "Elias Omega" };
+
+#define FIXED_VARIABLE_MAX 32767u
+
+static inline unsigned bit_length32(uint32_t n) {
+#ifdef __GNUC__
+    return n ? 32 - (unsigned)__builtin_clz(n) : 0;
+#else
+    return (unsigned)get_full_bit_length((int)n);
+#endif
+}
+
+static inline uint32_t low_bits(uint32_t n, unsigned bits) {
+    return bits ? n & (UINT32_MAX >> (32 - bits)) : 0;
+}
+
+static inline void put_fixed_variable(bit_writer *w, uint32_t n) {
+    unsigned len = bit_length32(n);
+    bw_put(w, len, 4);
+    if (len > 1) bw_put(w, low_bits(n, len - 1), len - 1);
+}
+
+static inline void put_gamma(bit_writer *w, uint32_t n) {
+    // Ведущие нули кода - старшие биты самого n, записанного в 2*order+1 бит
+    unsigned order = bit_length32(n) - 1;
+    if (order < 16) {
+        bw_put(w, n, 2 * order + 1);
+    } else {
+        bw_put(w, 0, order);
+        bw_put(w, n, order + 1);
+    }
+}
+
+static inline void put_delta(bit_writer *w, uint32_t n) {
+    unsigned len = bit_length32(n);
+    put_gamma(w, len);
+    bw_put(w, low_bits(n, len - 1), len - 1);
+}
+
+static inline void put_omega(bit_writer *w, uint32_t n) {
+    // Группы записываются от последней к первой: каждая - длина следующей минус 1
+    uint32_t groups[6];
+    unsigned lens[6], count = 0;
+    while (n > 1) {
+        unsigned len = bit_length32(n);
+        groups[count] = n;
+        lens[count++] = len;
+        n = len - 1;
+    }
+    while (count > 0) {
+        count--;
+        bw_put(w, groups[count], lens[count]);
+    }
+    bw_put(w, 0, 1);
+}
+
+// Верхняя граница размера потока из count чисел любого кода
+size_t elias_bound(size_t count) {
+    return count * 8 + 8;
+}
+
+// Кодирует массив в out (не меньше elias_bound(count) байт); возвращает
+// размер потока или -1, если число не представимо выбранным кодом
+long elias_encode(elias_code code, const uint32_t *values, size_t count, uint8_t *out) {
+    bit_writer w;
+    bw_init(&w, out);
+    switch (code) {
+    case CODE_FIXED_VARIABLE:
+        for (size_t i = 0; i < count; i++) {
+            if (values[i] > FIXED_VARIABLE_MAX) return -1;
+            put_fixed_variable(&w, values[i]);
+        }
+        break;
+    case CODE_GAMMA:
+        for (size_t i = 0; i < count; i++) {
+            if (values[i] == 0) return -1;
+            put_gamma(&w, values[i]);
+        }
+        break;
+    case CODE_DELTA:
+        for (size_t i = 0; i < count; i++) {
+            if (values[i] == 0) return -1;
+            put_delta(&w, values[i]);
+        }
+        break;
+    case CODE_OMEGA:
+        for (size_t i = 0; i < count; i++) {
+            if (values[i] == 0) return -1;
+            put_omega(&w, values[i]);
+        }
+        break;
+    default:
+        return -1;
+    }
+    return (long)bw_flush(&w);
+}
+
+// ---- Декодирование ----
+// Три способа, от медленного к быстрому:
+//  DECODE_BITS  - по одному биту, теми же циклами, что get_log2_floor и
+//                 get_mantissa (эталон для сравнения);
+//  DECODE_CLZ   - длина кода одной инструкцией подсчёта ведущих нулей
+//                 (LZCNT/BSR), биты числа читаются целиком;
+//  DECODE_TABLE - по 12 битам потока таблица сразу выдаёт все короткие коды,
+//                 целиком лежащие в этих битах; длинные коды - через CLZ.
+
+typedef enum decode_method
+{
+    DECODE_BITS,
+    DECODE_CLZ,
+    DECODE_TABLE,
+    DECODE_METHOD_COUNT
+} decode_method;
+
+const char *decode_method_names[DECODE_METHOD_COUNT] = { "bit loop", "clz", "table" };
+
+static inline unsigned leading_zeros64(uint64_t x) {
+#ifdef __GNUC__
+    return x ? (unsigned)__builtin_clzll(x) : 64;
+#else
+    unsigned n = 0;
+    while (n < 64 && !(x >> 63)) {
+        x <<= 1;
+        n++;
+    }
+    return n;
+#endif
+}
+
+static inline unsigned trailing_zeros64(uint64_t x) {
+#ifdef __GNUC__
+    return (unsigned)__builtin_ctzll(x);
+#else
+    unsigned n = 0;
+    while (!(x & 1)) {
+        x >>= 1;
+        n++;
+    }
+    return n;
+#endif
+}
+
+static inline uint32_t br_bit(bit_reader *r) {
+    if (r->fill == 0) br_refill(r);
+    return br_get(r, 1);
+}
+
+// Чтение одного кода; -1 - поток испорчен (код длиннее 32-битного числа)
+static inline int get_fixed_variable_bits(bit_reader *r, uint32_t *n) {
+    unsigned len = 0;
+    for (int i = 0; i < 4; i++) len = (len << 1) | br_bit(r);
+    uint32_t value = len ? 1 : 0;
+    for (unsigned i = 1; i < len; i++) value = (value << 1) | br_bit(r);
+    *n = value;
+    return 0;
+}
+
+static inline int get_gamma_bits(bit_reader *r, uint32_t *n) {
+    unsigned order = 0;
+    while (br_bit(r) == 0) {
+        if (++order > 31) return -1;
+    }
+    uint32_t value = 1;
+    for (unsigned i = 0; i < order; i++) value = (value << 1) | br_bit(r);
+    *n = value;
+    return 0;
+}
+
+static inline int get_delta_bits(bit_reader *r, uint32_t *n) {
+    uint32_t len;
+    if (get_gamma_bits(r, &len) != 0 || len > 32) return -1;
+    uint32_t value = 1;
+    for (unsigned i = 1; i < len; i++) value = (value << 1) | br_bit(r);
+    *n = value;
+    return 0;
+}
+
+static inline int get_omega_bits(bit_reader *r, uint32_t *n) {
+    uint32_t value = 1;
+    while (br_bit(r) == 1) {
+        if (value > 31) return -1;
+        uint32_t group = 1;
+        for (uint32_t i = 0; i < value; i++) group = (group << 1) | br_bit(r);
+        value = group;
+    }
+    *n = value;
+    return 0;
+}
+
+static inline int get_fixed_variable(bit_reader *r, uint32_t *n) {
+    br_refill(r);
+    unsigned len = br_get(r, 4);
+    *n = len ? (1u << (len - 1)) | br_get(r, len - 1) : 0;
+    return 0;
+}
+
+static inline int get_gamma(bit_reader *r, uint32_t *n) {
+    br_refill(r);
+    unsigned order = leading_zeros64(r->acc);
+    if (order > 31) return -1;
+    if (2 * order + 1 <= r->fill) {
+        // Нули и число читаются одним сдвигом: нули - старшие биты числа
+        *n = (uint32_t)(r->acc >> (63 - 2 * order));
+        r->acc <<= 2 * order + 1;
+        r->fill -= 2 * order + 1;
+    } else {
+        br_get(r, order);
+        br_refill(r);
+        *n = br_get(r, order + 1);
+    }
+    return 0;
+}
+
+static inline int get_delta(bit_reader *r, uint32_t *n) {
+    uint32_t len;
+    if (get_gamma(r, &len) != 0 || len > 32) return -1;
+    br_refill(r);
+    *n = (1u << (len - 1)) | br_get(r, len - 1);
+    return 0;
+}
+
+// Группы омега-кода читаются целиком, каждая длиной в предыдущее значение + 1
+static inline int get_omega(bit_reader *r, uint32_t *n) {
+    uint32_t value = 1;
+    for (;;) {
+        br_refill(r);
+        if (!(r->acc >> 63)) {
+            br_get(r, 1);
+            *n = value;
+            return 0;
+        }
+        if (value > 31) return -1;
+        value = br_get(r, value + 1);
+    }
+}
+
+static inline int get_code(elias_code code, bit_reader *r, uint32_t *n) {
+    switch (code) {
+    case CODE_FIXED_VARIABLE: return get_fixed_variable(r, n);
+    case CODE_GAMMA: return get_gamma(r, n);
+    case CODE_DELTA: return get_delta(r, n);
+    default: return get_omega(r, n);
+    }
+}
+
+static inline int get_code_bits(elias_code code, bit_reader *r, uint32_t *n) {
+    switch (code) {
+    case CODE_FIXED_VARIABLE: return get_fixed_variable_bits(r, n);
+    case CODE_GAMMA: return get_gamma_bits(r, n);
+    case CODE_DELTA: return get_delta_bits(r, n);
+    default: return get_omega_bits(r, n);
+    }
+}
+
+#define DECODE_TABLE_BITS 12
+#define DECODE_TABLE_SYMBOLS 12     // Самый короткий код - 1 бит
+
+// Коды, целиком лежащие в первых DECODE_TABLE_BITS битах; числа в них
+// меньше 256. count == 0 - первый код длиннее.
+typedef struct decode_entry
+{
+    uint8_t count;
+    uint8_t bits;
+    uint8_t values[DECODE_TABLE_SYMBOLS];
+} decode_entry;
+
+static decode_entry decode_tables[CODE_COUNT][1 << DECODE_TABLE_BITS];
+static int decode_tables_ready = 0;
+
+// Таблицы строятся эталонным декодером. Вызывается до запуска потоков.
+void elias_init_tables(void) {
+    if (decode_tables_ready) return;
+    for (int code = 0; code < CODE_COUNT; code++) {
+        for (uint32_t peek = 0; peek < (1u << DECODE_TABLE_BITS); peek++) {
+            uint8_t bytes[8] = { (uint8_t)(peek >> (DECODE_TABLE_BITS - 8)),
+                                 (uint8_t)(peek << (16 - DECODE_TABLE_BITS)) };
+            bit_reader r;
+            br_init(&r, bytes, sizeof(bytes));
+            decode_entry *e = &decode_tables[code][peek];
+            e->count = 0;
+            e->bits = 0;
+            uint32_t value;
+            while (e->count < DECODE_TABLE_SYMBOLS && get_code_bits((elias_code)code, &r, &value) == 0) {
+                size_t used = r.pos * 8 - r.fill;
+                if (used > DECODE_TABLE_BITS || value > 255) break;
+                e->values[e->count++] = (uint8_t)value;
+                e->bits = (uint8_t)used;
+            }
+        }
+    }
+    decode_tables_ready = 1;
+}
+
+static int decode_with_table(elias_code code, bit_reader *r, uint32_t *values, size_t count) {
+    const decode_entry *table = decode_tables[code];
+    size_t i = 0;
+    while (count - i >= DECODE_TABLE_SYMBOLS) {
+        if (r->fill < DECODE_TABLE_BITS) br_refill(r);
+        const decode_entry *e = &table[r->acc >> (64 - DECODE_TABLE_BITS)];
+        if (e->count == 0) {
+            if (get_code(code, r, &values[i++]) != 0) return -1;
+            continue;
+        }
+        for (int k = 0; k < DECODE_TABLE_SYMBOLS; k++) values[i + k] = e->values[k];
+        i += e->count;
+        r->acc <<= e->bits;
+        r->fill -= e->bits;
+    }
+    for (; i < count; i++)
+        if (get_code(code, r, &values[i]) != 0) return -1;
+    return 0;
+}
+
+// Декодирует count чисел из потока выбранным способом; -1 - поток испорчен
+// или короче нужного
+int elias_decode_with(elias_code code, decode_method method, const uint8_t *in, size_t size,
+                      uint32_t *values, size_t count) {
+    if ((unsigned)code >= CODE_COUNT) return -1;
+    bit_reader r;
+    br_init(&r, in, size);
+    int status = 0;
+    if (method == DECODE_TABLE) {
+        elias_init_tables();
+        status = decode_with_table(code, &r, values, count);
+    } else if (method == DECODE_CLZ) {
+        for (size_t i = 0; i < count && status == 0; i++) status = get_code(code, &r, &values[i]);
+    } else {
+        for (size_t i = 0; i < count && status == 0; i++) status = get_code_bits(code, &r, &values[i]);
+    }
+    return (status != 0 || br_overrun(&r)) ? -1 : 0;
+}
+
+int elias_decode(elias_code code, const uint8_t *in, size_t size, uint32_t *values, size_t count) {
+    return elias_decode_with(code, DECODE_TABLE, in, size, values, count);
+}
+
+// ---- Целочисленные кодеки для SIMD ----
+// Коды Элиаса читаются бит за битом. Для списков номеров (постинг-листы,
+// списки ID) рядом есть кодеки, которые декодируются словами и векторами:
+//  group varint - по 4 числа на управляющий байт с длинами 1..4 байта,
+//                 четвёрка разбирается одной перестановкой байт (PSHUFB);
+//  bit-packing  - блоки по 128 чисел: минимум блока (frame of reference)
+//                 и разности в одинаковом числе бит, уложенные по 4 полосам
+//                 так, что одна SSE2-загрузка даёт по слову каждой полосы;
+//  Elias-Fano   - неубывающая последовательность: младшие биты каждого
+//                 числа подряд, старшие - унарным битовым вектором.
+// Все кодеки, включая коды Элиаса, доступны через одну таблицу int_codecs.
+
+static inline void store_le32(uint8_t *p, uint32_t v) {
+    p[0] = (uint8_t)v;
+    p[1] = (uint8_t)(v >> 8);
+    p[2] = (uint8_t)(v >> 16);
+    p[3] = (uint8_t)(v >> 24);
+}
+
+static inline uint32_t load_le32(const uint8_t *p) {
+    return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+// -- Group varint --
+
+size_t group_varint_bound(size_t count) {
+    return (count + 3) / 4 + count * 4 + 4;
+}
+
+long group_varint_encode(const uint32_t *values, size_t count, uint8_t *out) {
+    uint8_t *p = out;
+    for (size_t i = 0; i < count; i += 4) {
+        uint8_t *control = p++;
+        *control = 0;
+        for (size_t k = 0; k < 4 && i + k < count; k++) {
+            uint32_t v = values[i + k];
+            unsigned len = v ? (bit_length32(v) + 7) / 8 : 1;
+            store_le32(p, v);   // Лишние байты перезапишет следующее число
+            p += len;
+            *control |= (uint8_t)((len - 1) << (2 * k));
+        }
+    }
+    return (long)(p - out);
+}
+
+static int group_varint_decode_scalar(const uint8_t *in, const uint8_t *end, uint32_t *values, size_t i, size_t count) {
+    for (; i < count; i += 4) {
+        if (in >= end) return -1;
+        unsigned control = *in++;
+        for (size_t k = 0; k < 4 && i + k < count; k++) {
+            unsigned len = ((control >> (2 * k)) & 3) + 1;
+            if ((size_t)(end - in) < len) return -1;
+            uint32_t v = 0;
+            for (unsigned b = 0; b < len; b++) v |= (uint32_t)in[b] << (8 * b);
+            values[i + k] = v;
+            in += len;
+        }
+    }
+    return in == end ? 0 : -1;
+}
+
+#ifdef HAVE_X86_SIMD
+// Для каждого управляющего байта: перестановка 16 байт данных в 4 числа
+// и суммарная длина четвёрки
+static uint8_t group_varint_shuffle[256][16];
+static uint8_t group_varint_length[256];
+
+static int group_varint_ready = 0;
+
+static void group_varint_init(void) {
+    if (group_varint_ready) return;
+    for (unsigned control = 0; control < 256; control++) {
+        unsigned offset = 0;
+        for (unsigned k = 0; k < 4; k++) {
+            unsigned len = ((control >> (2 * k)) & 3) + 1;
+            for (unsigned b = 0; b < 4; b++)
+                group_varint_shuffle[control][4 * k + b] = b < len ? (uint8_t)(offset + b) : 0x80;
+            offset += len;
+        }
+        group_varint_length[control] = (uint8_t)offset;
+    }
+    group_varint_ready = 1;
+}
+
+__attribute__((target("ssse3")))
+static int group_varint_decode_ssse3(const uint8_t *in, const uint8_t *end, uint32_t *values, size_t count) {
+    size_t i = 0;
+    // Загрузка берёт 16 байт после управляющего - столько должно оставаться в потоке
+    while (i + 4 <= count && end - in >= 17) {
+        unsigned control = *in;
+        __m128i data = _mm_loadu_si128((const __m128i *)(in + 1));
+        __m128i shuffle = _mm_loadu_si128((const __m128i *)group_varint_shuffle[control]);
+        _mm_storeu_si128((__m128i *)(values + i), _mm_shuffle_epi8(data, shuffle));
+        in += 1 + group_varint_length[control];
+        i += 4;
+    }
+    return group_varint_decode_scalar(in, end, values, i, count);
+}
+#endif
+
+int group_varint_decode(const uint8_t *in, size_t size, uint32_t *values, size_t count) {
+#ifdef HAVE_X86_SIMD
+    if (__builtin_cpu_supports("ssse3")) {
+        group_varint_init();
+        return group_varint_decode_ssse3(in, in + size, values, count);
+    }
+#endif
+    return group_varint_decode_scalar(in, in + size, values, 0, count);
+}
+
+// -- Bit-packing --
+// Блок: минимум (4 байта), ширина b (1 байт), затем 4*b 32-битных слов:
+// слово w полосы L лежит на месте 4*w + L, число 4*j + L - j-е в полосе L.
+// Неполный последний блок дополняется минимумом (нулевыми разностями).
+
+#define PACK_BLOCK 128
+#define PACK_LANE (PACK_BLOCK / 4)
+
+size_t bitpack_bound(size_t count) {
+    return (count + PACK_BLOCK - 1) / PACK_BLOCK * (5 + PACK_BLOCK * 4);
+}
+
+long bitpack_encode(const uint32_t *values, size_t count, uint8_t *out) {
+    uint8_t *p = out;
+    for (size_t start = 0; start < count; start += PACK_BLOCK) {
+        size_t n = count - start < PACK_BLOCK ? count - start : PACK_BLOCK;
+        const uint32_t *block = values + start;
+        uint32_t min = block[0], max = block[0];
+        for (size_t i = 1; i < n; i++) {
+            if (block[i] < min) min = block[i];
+            if (block[i] > max) max = block[i];
+        }
+        unsigned bits = bit_length32(max - min);
+        store_le32(p, min);
+        p[4] = (uint8_t)bits;
+        p += 5;
+        for (unsigned lane = 0; lane < 4; lane++) {
+            uint64_t acc = 0;
+            unsigned fill = 0, word = 0;
+            for (size_t j = 0; j < PACK_LANE; j++) {
+                size_t i = 4 * j + lane;
+                acc |= (uint64_t)(i < n ? block[i] - min : 0) << fill;
+                fill += bits;
+                if (fill >= 32) {
+                    store_le32(p + 4 * (4 * word + lane), (uint32_t)acc);
+                    word++;
+                    acc >>= 32;
+                    fill -= 32;
+                }
+            }
+        }
+        p += 16 * bits;
+    }
+    return (long)(p - out);
+}
+
+static void bitpack_unpack_scalar(const uint8_t *in, unsigned bits, uint32_t min, uint32_t *out) {
+    uint32_t mask = bits == 32 ? UINT32_MAX : (1u << bits) - 1;
+    for (unsigned lane = 0; lane < 4; lane++) {
+        uint64_t acc = 0;
+        unsigned fill = 0, word = 0;
+        for (size_t j = 0; j < PACK_LANE; j++) {
+            if (fill < bits) {
+                acc |= (uint64_t)load_le32(in + 4 * (4 * word + lane)) << fill;
+                word++;
+                fill += 32;
+            }
+            out[4 * j + lane] = min + ((uint32_t)acc & mask);
+            acc >>= bits;
+            fill -= bits;
+        }
+    }
+}
+
+#ifdef HAVE_X86_SIMD
+__attribute__((target("sse2")))
+static void bitpack_unpack_sse2(const uint8_t *in, unsigned bits, uint32_t min, uint32_t *out) {
+    const __m128i mask = _mm_set1_epi32(bits == 32 ? -1 : (int)((1u << bits) - 1));
+    const __m128i base = _mm_set1_epi32((int)min);
+    const __m128i *words = (const __m128i *)in;
+    __m128i current = _mm_loadu_si128(words);
+    unsigned offset = 0;
+    for (size_t j = 0; j < PACK_LANE; j++) {
+        __m128i v = _mm_srl_epi32(current, _mm_cvtsi32_si128((int)offset));
+        offset += bits;
+        // В последнем числе полосы слова кончаются ровно на границе
+        if (offset >= 32 && j + 1 < PACK_LANE) {
+            current = _mm_loadu_si128(++words);
+            offset -= 32;
+            if (offset > 0) v = _mm_or_si128(v, _mm_sll_epi32(current, _mm_cvtsi32_si128((int)(bits - offset))));
+        }
+        _mm_storeu_si128((__m128i *)(out + 4 * j), _mm_add_epi32(_mm_and_si128(v, mask), base));
+    }
+}
+#endif
+
+int bitpack_decode(const uint8_t *in, size_t size, uint32_t *values, size_t count) {
+    const uint8_t *end = in + size;
+    uint32_t tail[PACK_BLOCK];
+#ifdef HAVE_X86_SIMD
+    int sse2 = __builtin_cpu_supports("sse2");
+#endif
+    for (size_t start = 0; start < count; start += PACK_BLOCK) {
+        if (end - in < 5) return -1;
+        uint32_t min = load_le32(in);
+        unsigned bits = in[4];
+        in += 5;
+        if (bits > 32 || (size_t)(end - in) < 16 * (size_t)bits) return -1;
+        uint32_t *out = count - start >= PACK_BLOCK ? values + start : tail;
+        if (bits == 0) {
+            for (size_t i = 0; i < PACK_BLOCK; i++) out[i] = min;
+        }
+#ifdef HAVE_X86_SIMD
+        else if (sse2) bitpack_unpack_sse2(in, bits, min, out);
+#endif
+        else bitpack_unpack_scalar(in, bits, min, out);
+        if (out == tail) memcpy(values + start, tail, (count - start) * sizeof(uint32_t));
+        in += 16 * bits;
+    }
+    return in == end ? 0 : -1;
+}
+
+// -- Elias-Fano --
+// Байт l, затем младшие l бит каждого числа подряд (битовый поток, как у
+// кодов Элиаса), затем 64-битные слова старшей части: число i со старшей
+// частью h даёт единицу в бите h + i. l = floor(log2(u/n)), u - наибольшее
+// число + 1, поэтому старшая часть занимает не больше 3n + 1 бит.
+
+size_t elias_fano_bound(size_t count) {
+    return 1 + (31 * count + 7) / 8 + ((3 * count + 1) + 63) / 64 * 8;
+}
+
+long elias_fano_encode(const uint32_t *values, size_t count, uint8_t *out) {
+    for (size_t i = 1; i < count; i++)
+        if (values[i] < values[i - 1]) return -1;
+    uint64_t universe = count ? (uint64_t)values[count - 1] + 1 : 0;
+    unsigned low = 0;
+    while (count && low < 31 && (universe >> (low + 1)) >= count) low++;
+
+    out[0] = (uint8_t)low;
+    bit_writer w;
+    bw_init(&w, out + 1);
+    for (size_t i = 0; i < count; i++) bw_put(&w, low_bits(values[i], low), low);
+    uint8_t *high = out + 1 + bw_flush(&w);
+
+    size_t high_bits = count ? (size_t)(values[count - 1] >> low) + count : 0;
+    size_t words = (high_bits + 63) / 64;
+    memset(high, 0, words * 8);
+    for (size_t i = 0; i < count; i++) {
+        size_t bit = (size_t)(values[i] >> low) + i;
+        high[bit / 8] |= (uint8_t)(1u << (bit % 8));
+    }
+    return (long)(high - out + words * 8);
+}
+
+int elias_fano_decode(const uint8_t *in, size_t size, uint32_t *values, size_t count) {
+    if (count == 0) return size == 1 || size == 0 ? 0 : -1;
+    if (size < 1 || in[0] > 31) return -1;
+    unsigned low = in[0];
+    size_t low_size = ((size_t)low * count + 7) / 8;
+    if (size - 1 < low_size) return -1;
+    const uint8_t *high = in + 1 + low_size;
+    size_t words = (size - 1 - low_size) / 8;
+    if ((size - 1 - low_size) % 8 != 0) return -1;
+
+    bit_reader r;
+    br_init(&r, in + 1, low_size);
+    size_t i = 0;
+    for (size_t word = 0; word < words && i < count; word++) {
+        uint64_t bits = 0;
+        for (int b = 7; b >= 0; b--) bits = (bits << 8) | high[8 * word + (size_t)b];
+        while (bits && i < count) {
+            uint64_t upper = 64 * (uint64_t)word + trailing_zeros64(bits) - i;
+            br_refill(&r);
+            values[i++] = (uint32_t)(upper << low) | br_get(&r, low);
+            bits &= bits - 1;
+        }
+    }
+    return (i == count && !br_overrun(&r)) ? 0 : -1;
+}
+
+// -- Общая таблица кодеков --
+
+typedef struct int_codec
+{
+    const char *key;    // Имя в командной строке
+    const char *name;
+    int monotone;       // Принимает только неубывающие последовательности
+    int positive;       // Не представляет 0
+    size_t (*bound)(size_t count);
+    long (*encode)(const uint32_t *values, size_t count, uint8_t *out);
+    int (*decode)(const uint8_t *in, size_t size, uint32_t *values, size_t count);
+} int_codec;
+
+static long fixed_variable_encode(const uint32_t *values, size_t count, uint8_t *out) {
+    return elias_encode(CODE_FIXED_VARIABLE, values, count, out);
+}
+static int fixed_variable_decode(const uint8_t *in, size_t size, uint32_t *values, size_t count) {
+    return elias_decode(CODE_FIXED_VARIABLE, in, size, values, count);
+}
+static long gamma_encode(const uint32_t *values, size_t count, uint8_t *out) {
+    return elias_encode(CODE_GAMMA, values, count, out);
+}
+static int gamma_decode(const uint8_t *in, size_t size, uint32_t *values, size_t count) {
+    return elias_decode(CODE_GAMMA, in, size, values, count);
+}
+static long delta_encode(const uint32_t *values, size_t count, uint8_t *out) {
+    return elias_encode(CODE_DELTA, values, count, out);
+}
+static int delta_decode(const uint8_t *in, size_t size, uint32_t *values, size_t count) {
+    return elias_decode(CODE_DELTA, in, size, values, count);
+}
+static long omega_encode(const uint32_t *values, size_t count, uint8_t *out) {
+    return elias_encode(CODE_OMEGA, values, count, out);
+}
+static int omega_decode(const uint8_t *in, size_t size, uint32_t *values, size_t count) {
+    return elias_decode(CODE_OMEGA, in, size, values, count);
+}
+
+const int_codec int_codecs[] = {
+    { "fixed", "Fixed+Var", 0, 0, elias_bound, fixed_variable_encode, fixed_variable_decode },
+    { "gamma", "Elias Gamma", 0, 1, elias_bound, gamma_encode, gamma_decode },
+    { "delta", "Elias Delta", 0, 1, elias_bound, delta_encode, delta_decode },
+    { "omega", "Elias Omega", 0, 1, elias_bound, omega_encode, omega_decode },
+    { "varint", "Group varint", 0, 0, group_varint_bound, group_varint_encode, group_varint_decode },
+    { "bitpack", "Bit-packing", 0, 0, bitpack_bound, bitpack_encode, bitpack_decode },
+    { "ef", "Elias-Fano", 1, 0, elias_fano_bound, elias_fano_encode, elias_fano_decode },
+};
+
+#define INT_CODEC_COUNT (sizeof(int_codecs) / sizeof(int_codecs[0]))
+
+// Таблицы декодеров; вызывается до запуска потоков
+void int_codecs_init(void) {
+    elias_init_tables();
+#ifdef HAVE_X86_SIMD
+    group_varint_init();
+#endif
+}
+
+// ---- Проверка и замер ----
+
+// Первые bits бит потока строкой из '0'/'1'
+void bits_to_string(const uint8_t *in, size_t bits, char *out) {
+    for (size_t i = 0; i < bits; i++) out[i] = ((in[i / 8] >> (7 - i % 8)) & 1) ? '1' : '0';
+    out[bits] = '\0';
+}
+
+void strip_spaces(const char *in, char *out) {
+    for (; *in; in++) if (*in != ' ') *out++ = *in;
+    *out = '\0';
+}
+
+// Код каждого числа 0..limit совпадает со строковой формой таблицы
+int check_string_forms(int limit) {
+    char expected[MAX_BITS], text[MAX_BITS], actual[MAX_BITS];
+    uint8_t packed[16];
+    for (int n = 0; n <= limit; n++) {
+        for (int code = 0; code < CODE_COUNT; code++) {
+            if (code == CODE_FIXED_VARIABLE) code_fixed_variable(n, text);
+            else if (code == CODE_GAMMA) code_elias_gamma(n, text);
+            else if (code == CODE_DELTA) code_elias_delta(n, text);
+            else code_elias_omega(n, text);
+            if (strcmp(text, "-") == 0 || (code == CODE_FIXED_VARIABLE && (uint32_t)n > FIXED_VARIABLE_MAX))
+                continue;
+            strip_spaces(text, expected);
+
+            bit_writer w;
+            bw_init(&w, packed);
+            uint32_t value = (uint32_t)n;
+            if (code == CODE_FIXED_VARIABLE) put_fixed_variable(&w, value);
+            else if (code == CODE_GAMMA) put_gamma(&w, value);
+            else if (code == CODE_DELTA) put_delta(&w, value);
+            else put_omega(&w, value);
+            size_t bits = bw_bits(&w);
+            size_t size = bw_flush(&w);
+            bits_to_string(packed, bits, actual);
+
+            for (int method = 0; method < DECODE_METHOD_COUNT; method++) {
+                uint32_t decoded = 0;
+                if (strcmp(expected, actual) != 0 ||
+                    elias_decode_with((elias_code)code, (decode_method)method, packed, size, &decoded, 1) != 0 ||
+                    decoded != value) {
+                    printf("%s: N=%d, ожидалось %s, получено %s (декодировано %u, %s)\n",
+                           elias_code_names[code], n, expected, actual, decoded, decode_method_names[method]);
+                    return -1;
+                }
+            }
+        }
+    }
+    return 0;
+}
+
+static uint64_t bench_now(void) {
+#ifdef _WIN32
+    LARGE_INTEGER freq, now;
+    QueryPerformanceFrequency(&freq);
+    QueryPerformanceCounter(&now);
+    return (uint64_t)((double)now.QuadPart * 1e9 / (double)freq.QuadPart);
+#else
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+#endif
+}
+
+static uint64_t bench_next(uint64_t *state) {
+    uint64_t x = *state;
+    x ^= x >> 12;
+    x ^= x << 25;
+    x ^= x >> 27;
+    *state = x;
+    return x * 0x2545F4914F6CDD1DULL;
+}
+
+typedef enum bench_distribution
+{
+    VALUES_GEOMETRIC,
+    VALUES_LOG_UNIFORM,
+    VALUES_UNIFORM,
+    VALUES_COUNT
+} bench_distribution;
+
+const char *bench_distribution_names[VALUES_COUNT] = { "geometric", "log-uniform", "uniform" };
+
+// Числа 1..32767. Длина в битах: geometric - k с вероятностью 2^-k (как
+// разности соседних номеров в списке), log-uniform - равновероятна;
+// uniform - все числа равновероятны.
+void bench_values(uint32_t *values, size_t count, bench_distribution distribution, uint64_t seed) {
+    uint64_t state = seed;
+    for (size_t i = 0; i < count; i++) {
+        uint64_t x = bench_next(&state);
+        unsigned len;
+        if (distribution == VALUES_GEOMETRIC) {
+            len = 1 + leading_zeros64(x | 1);
+            if (len > 15) len = 15;
+        } else if (distribution == VALUES_LOG_UNIFORM) {
+            len = 1 + (unsigned)((x >> 32) % 15);
+        } else {
+            values[i] = 1 + (uint32_t)((x >> 32) % FIXED_VARIABLE_MAX);
+            continue;
+        }
+        values[i] = (1u << (len - 1)) | low_bits((uint32_t)x, len - 1);
+    }
+}
+
+static double bench_rate(size_t count, uint64_t ns) {
+    return ns ? (double)count / ((double)ns / 1e9) / 1e6 : 0.0;
+}
+
+// Сверка со строковыми формами, затем кодирование count чисел каждым кодом
+// и декодирование каждым способом с проверкой совпадения
+int run_benchmark(size_t count) {
+    if (check_string_forms(65536) != 0) return 1;
+    printf("Строковые формы 0..65536 совпадают с потоком\n\n");
+    elias_init_tables();
+
+    uint32_t *values = (uint32_t *)malloc((count ? count : 1) * sizeof(uint32_t));
+    uint32_t *decoded = (uint32_t *)malloc((count ? count : 1) * sizeof(uint32_t));
+    uint8_t *packed = (uint8_t *)malloc(elias_bound(count));
+    if (values == NULL || decoded == NULL || packed == NULL) {
+        printf("Недостаточно памяти!\n");
+        free(values);
+        free(decoded);
+        free(packed);
+        return 1;
+    }
+
+    memset(packed, 0, elias_bound(count));  // Страницы выделяются до замера
+    memset(decoded, 0, count * sizeof(uint32_t));
+
+    int status = 0;
+    printf("Mint/s - миллионов чисел в секунду\n");
+    printf("| %-11s | %-11s | %-8s | %-8s | %-8s | %-8s | %-8s |\n",
+           "Values", "Code", "Bits/int", "Encode", "bit loop", "clz", "table");
+    printf("|-------------|-------------|----------|----------|----------|----------|----------|\n");
+    for (int distribution = 0; distribution < VALUES_COUNT; distribution++) {
+        bench_values(values, count, (bench_distribution)distribution, 0x9E3779B97F4A7C15ull);
+        for (int code = 0; code < CODE_COUNT; code++) {
+            uint64_t start = bench_now();
+            long size = elias_encode((elias_code)code, values, count, packed);
+            uint64_t encode_ns = bench_now() - start;
+            printf("| %-11s | %-11s | %8.3f | %8.1f |", bench_distribution_names[distribution],
+                   elias_code_names[code], count && size > 0 ? (double)size * 8 / (double)count : 0.0,
+                   bench_rate(count, encode_ns));
+            for (int method = 0; method < DECODE_METHOD_COUNT; method++) {
+                start = bench_now();
+                int result = size < 0 ? -1 : elias_decode_with((elias_code)code, (decode_method)method,
+                                                                packed, (size_t)size, decoded, count);
+                uint64_t decode_ns = bench_now() - start;
+                if (result != 0 || memcmp(values, decoded, count * sizeof(uint32_t)) != 0) {
+                    printf(" %8s |", "ошибка");
+                    status = 1;
+                } else {
+                    printf(" %8.1f |", bench_rate(count, decode_ns));
+                }
+            }
+            printf("\n");
+        }
+    }
+    free(values);
+    free(decoded);
+    free(packed);
+    return status;
+}
+
+// Возрастающие номера с геометрическими промежутками (в среднем gap) -
+// модель постинг-листа; gaps получает разности (первая - номер + 1)
+void bench_ids(uint32_t *ids, uint32_t *gaps, size_t count, double gap, uint64_t seed) {
+    uint64_t state = seed;
+    uint64_t id = 0;
+    for (size_t i = 0; i < count; i++) {
+        double u = (double)((bench_next(&state) >> 11) + 1) / 9007199254740993.0;
+        uint64_t step = 1 + (uint64_t)(-log(u) * (gap - 1));
+        // Номера должны уместиться в 32 бита, оставаясь различными
+        if (id + step > UINT32_MAX - (count - i)) step = 1;
+        id = i ? id + step : step - 1;
+        ids[i] = (uint32_t)id;
+        gaps[i] = (uint32_t)(i ? id - ids[i - 1] : id + 1);
+    }
+}
+
+// Сравнение всех кодеков на списках номеров разной плотности: кодеки общего
+// вида сжимают разности и восстанавливают номера суммированием (оно входит в
+// время декодирования), Elias-Fano сжимает сами номера
+int run_comparison(size_t count) {
+    int_codecs_init();
+    size_t bound = 0;
+    for (size_t c = 0; c < INT_CODEC_COUNT; c++)
+        if (int_codecs[c].bound(count) > bound) bound = int_codecs[c].bound(count);
+
+    uint32_t *ids = (uint32_t *)malloc((count ? count : 1) * sizeof(uint32_t));
+    uint32_t *gaps = (uint32_t *)malloc((count ? count : 1) * sizeof(uint32_t));
+    uint32_t *decoded = (uint32_t *)malloc((count ? count : 1) * sizeof(uint32_t));
+    uint8_t *packed = (uint8_t *)malloc(bound ? bound : 1);
+    if (ids == NULL || gaps == NULL || decoded == NULL || packed == NULL) {
+        printf("Недостаточно памяти!\n");
+        free(ids);
+        free(gaps);
+        free(decoded);
+        free(packed);
+        return 1;
+    }
+    memset(packed, 0, bound);  // Страницы выделяются до замера
+    memset(decoded, 0, count * sizeof(uint32_t));
+
+    const double densities[] = { 2, 32, 1024 };
+    int status = 0;
+    printf("Список из %zu номеров; Mint/s - миллионов чисел в секунду\n", count);
+    printf("| %-10s | %-12s | %-8s | %-8s | %-8s |\n", "IDs", "Codec", "Bits/int", "Encode", "Decode");
+    printf("|------------|--------------|----------|----------|----------|\n");
+    for (size_t d = 0; d < sizeof(densities) / sizeof(densities[0]); d++) {
+        // Средний промежуток ограничен так, чтобы номера уместились в 32 бита
+        double gap = densities[d];
+        if (count && gap > 0.5 * (double)UINT32_MAX / (double)count) gap = 0.5 * (double)UINT32_MAX / (double)count;
+        if (gap < 1) gap = 1;
+        bench_ids(ids, gaps, count, gap, 0x9E3779B97F4A7C15ull + d);
+        char label[32];
+        snprintf(label, sizeof(label), "gap ~%.0f", gap);
+
+        for (size_t c = 0; c < INT_CODEC_COUNT; c++) {
+            const int_codec *codec = &int_codecs[c];
+            const uint32_t *input = codec->monotone ? ids : gaps;
+            uint64_t start = bench_now();
+            long size = codec->encode(input, count, packed);
+            uint64_t encode_ns = bench_now() - start;
+            printf("| %-10s | %-12s |", label, codec->name);
+            if (size < 0) {
+                printf(" %8s | %8s | %8s |\n", "-", "-", "-");
+                continue;
+            }
+
+            start = bench_now();
+            int result = codec->decode(packed, (size_t)size, decoded, count);
+            if (result == 0 && !codec->monotone) {
+                uint32_t id = 0;
+                for (size_t i = 0; i < count; i++) {
+                    id += decoded[i];
+                    decoded[i] = id - 1;
+                }
+            }
+            uint64_t decode_ns = bench_now() - start;
+            if (result != 0 || memcmp(ids, decoded, count * sizeof(uint32_t)) != 0) {
+                printf(" %8s |\n", "ошибка");
+                status = 1;
+                continue;
+            }
+            printf(" %8.3f | %8.1f | %8.1f |\n", count ? (double)size * 8 / (double)count : 0.0,
+                   bench_rate(count, encode_ns), bench_rate(count, decode_ns));
+        }
+    }
+    free(ids);
+    free(gaps);
+    free(decoded);
+    free(packed);
+    return status;
+}
+
+// ---- Контейнер: потоковое кодирование файлов ----
+// Файл чисел (32-битные little-endian или десятичный текст) читается
+// порциями по chunk_values чисел; каждая порция кодируется независимо,
+// поэтому порции обрабатываются параллельно, а прочитать можно любую одну.
+// Пока потоки кодируют одну партию порций, основной поток записывает
+// предыдущую и читает следующую.
+//
+// Формат (числа little-endian):
+//   заголовок: "NEKALCH1", номер кодека в int_codecs (u32), chunk_values (u32),
+//     флаги преобразования (u32)
+//   кадр порции: число значений (u32), размер данных (u32), данные кодека
+//   оглавление: для каждой порции смещение кадра (u64), значений (u32), размер (u32)
+//   концовка: число порций (u64), смещение оглавления (u64), "NEKALEND"
+
+#define CONTAINER_MAGIC "NEKALCH1"
+#define CONTAINER_END "NEKALEND"
+#define CONTAINER_HEADER 20
+#define CONTAINER_FRAME 8
+#define CONTAINER_ENTRY 16
+#define CONTAINER_TRAILER 24
+#define CHUNK_VALUES_DEFAULT (1u << 20)
+#define CHUNK_VALUES_MAX (1u << 26)     // Размер кадра должен уместиться в u32
+#define CONTAINER_MAX_THREADS 64
+#define TEXT_BUFFER_SIZE (1u << 20)
+
+// Преобразования порции перед кодеком (флаги заголовка)
+#define CONTAINER_GAPS 1u       // Разности соседних чисел; первое число порции как есть
+#define CONTAINER_SHIFT 2u      // v + 1 для кодов, не представляющих 0
+
+#ifdef _WIN32
+typedef __int64 file_offset;
+#define file_seek _fseeki64
+#else
+typedef off_t file_offset;
+#define file_seek fseeko
+#endif
+
+static inline void store_le64(uint8_t *p, uint64_t v) {
+    store_le32(p, (uint32_t)v);
+    store_le32(p + 4, (uint32_t)(v >> 32));
+}
+
+static inline uint64_t load_le64(const uint8_t *p) {
+    return (uint64_t)load_le32(p) | ((uint64_t)load_le32(p + 4) << 32);
+}
+
+// Число ядер процессора
+int cpu_count(void) {
+#ifdef _WIN32
+    SYSTEM_INFO info;
+    GetSystemInfo(&info);
+    return (int)info.dwNumberOfProcessors;
+#else
+    long n = sysconf(_SC_NPROCESSORS_ONLN);
+    return n > 0 ? (int)n : 1;
+#endif
+}
+
+const int_codec *find_codec(const char *key) {
+    for (size_t c = 0; c < INT_CODEC_COUNT; c++)
+        if (strcmp(int_codecs[c].key, key) == 0) return &int_codecs[c];
+    return NULL;
+}
+
+// Потоки, запущенные start_tasks; задачи, для которых поток создать не
+// удалось, выполняются сразу в текущем
+typedef struct task_group
+{
+    pthread_t threads[CONTAINER_MAX_THREADS];
+    char started[CONTAINER_MAX_THREADS];
+    int count;
+} task_group;
+
+static void start_tasks(task_group *g, void *(*fn)(void *), void *tasks, size_t task_size, int count) {
+    g->count = count;
+    for (int t = 0; t < count; t++) {
+        void *task = (char *)tasks + (size_t)t * task_size;
+        g->started[t] = pthread_create(&g->threads[t], NULL, fn, task) == 0;
+        if (!g->started[t]) fn(task);
+    }
+}
+
+static void join_tasks(task_group *g) {
+    for (int t = 0; t < g->count; t++)
+        if (g->started[t]) pthread_join(g->threads[t], NULL);
+    g->count = 0;
+}
+
+// -- Чтение и запись чисел --
+
+typedef struct int_reader
+{
+    FILE *fp;
+    int text;
+    uint8_t *buf;           // Буфер текста
+    size_t pos, len;
+    uint64_t number;        // Текстовое число, разорванное границей буфера
+    int in_number;
+    int error;
+} int_reader;
+
+// Читает до max чисел; 0 - конец файла или ошибка (r->error)
+size_t read_ints(int_reader *r, uint32_t *out, size_t max) {
+    size_t count = 0;
+    if (!r->text) {
+        size_t bytes = fread(out, 1, max * sizeof(uint32_t), r->fp);
+        if (bytes % sizeof(uint32_t) != 0) {
+            printf("Размер двоичного файла не кратен 4 байтам\n");
+            r->error = 1;
+            return 0;
+        }
+        count = bytes / sizeof(uint32_t);
+        for (size_t i = 0; i < count; i++) out[i] = load_le32((const uint8_t *)&out[i]);
+        if (count < max && ferror(r->fp)) r->error = 1;
+        return count;
+    }
+    while (count < max) {
+        if (r->pos == r->len) {
+            r->len = fread(r->buf, 1, TEXT_BUFFER_SIZE, r->fp);
+            r->pos = 0;
+            if (r->len == 0) {
+                if (ferror(r->fp)) r->error = 1;
+                if (r->in_number) {
+                    out[count++] = (uint32_t)r->number;
+                    r->in_number = 0;
+                }
+                break;
+            }
+        }
+        uint8_t c = r->buf[r->pos++];
+        if (c >= '0' && c <= '9') {
+            r->number = r->in_number ? r->number * 10 + (c - '0') : (uint64_t)(c - '0');
+            r->in_number = 1;
+            if (r->number > UINT32_MAX) {
+                printf("Число больше 4294967295 в текстовом файле\n");
+                r->error = 1;
+                return 0;
+            }
+        } else if (c == ' ' || c == '\n' || c == '\r' || c == '\t' || c == ',' || c == ';') {
+            if (r->in_number) out[count++] = (uint32_t)r->number;
+            r->in_number = 0;
+        } else {
+            printf("Недопустимый символ '%c' в текстовом файле\n", c);
+            r->error = 1;
+            return 0;
+        }
+    }
+    return count;
+}
+
+static size_t format_uint32(char *p, uint32_t v) {
+    char digits[10];
+    size_t n = 0;
+    do {
+        digits[n++] = (char)('0' + v % 10);
+        v /= 10;
+    } while (v);
+    for (size_t i = 0; i < n; i++) p[i] = digits[n - 1 - i];
+    return n;
+}
+
+// Числа в байты файла: текст по одному в строке или little-endian;
+// out должен вмещать 11 байт на число
+static size_t format_ints(const uint32_t *values, size_t count, int text, uint8_t *out) {
+    size_t len = 0;
+    for (size_t i = 0; i < count; i++) {
+        if (text) {
+            len += format_uint32((char *)out + len, values[i]);
+            out[len++] = '\n';
+        } else {
+            store_le32(out + len, values[i]);
+            len += 4;
+        }
+    }
+    return len;
+}
+
+// -- Задания для потоков --
+
+typedef struct chunk_job
+{
+    const int_codec *codec;
+    uint32_t *values;
+    size_t count;
+    uint8_t *packed;        // Данные кодека (bound(chunk_values) байт)
+    size_t size;
+    uint8_t *output;        // Декодированные числа в формате файла
+    size_t output_len;
+    int text;
+    unsigned flags;         // CONTAINER_GAPS, CONTAINER_SHIFT
+    int result;             // -1 - не представимы кодеком, -2 - не упорядочены
+} chunk_job;
+
+// Применяет флаги к числам порции на месте
+static int transform_chunk(uint32_t *values, size_t count, unsigned flags) {
+    if (flags & CONTAINER_GAPS) {
+        for (size_t i = count; i-- > 1;) {
+            if (values[i] < values[i - 1]) return -2;
+            values[i] -= values[i - 1];
+        }
+    }
+    if (flags & CONTAINER_SHIFT) {
+        for (size_t i = 0; i < count; i++) {
+            if (values[i] == UINT32_MAX) return -1;
+            values[i]++;
+        }
+    }
+    return 0;
+}
+
+// Обратное преобразование после декодирования
+static int restore_chunk(uint32_t *values, size_t count, unsigned flags) {
+    if (flags & CONTAINER_SHIFT) {
+        for (size_t i = 0; i < count; i++) {
+            if (values[i] == 0) return -1;
+            values[i]--;
+        }
+    }
+    if (flags & CONTAINER_GAPS)
+        for (size_t i = 1; i < count; i++) values[i] += values[i - 1];
+    return 0;
+}
+
+static void *encode_chunk_run(void *arg) {
+    chunk_job *job = (chunk_job *)arg;
+    job->size = 0;
+    job->result = transform_chunk(job->values, job->count, job->flags);
+    if (job->result != 0) return NULL;
+    long size = job->codec->encode(job->values, job->count, job->packed);
+    job->result = size < 0 ? -1 : 0;
+    job->size = size < 0 ? 0 : (size_t)size;
+    return NULL;
+}
+
+static void *decode_chunk_run(void *arg) {
+    chunk_job *job = (chunk_job *)arg;
+    job->result = job->codec->decode(job->packed, job->size, job->values, job->count);
+    if (job->result == 0) job->result = restore_chunk(job->values, job->count, job->flags);
+    if (job->result == 0) job->output_len = format_ints(job->values, job->count, job->text, job->output);
+    return NULL;
+}
+
+// Две партии по threads заданий: одна в работе, другая на вводе-выводе
+typedef struct chunk_batches
+{
+    chunk_job *jobs;        // 2 * threads
+    int threads;
+} chunk_batches;
+
+static void batches_free(chunk_batches *b) {
+    for (int i = 0; b->jobs != NULL && i < 2 * b->threads; i++) {
+        free(b->jobs[i].values);
+        free(b->jobs[i].packed);
+        free(b->jobs[i].output);
+    }
+    free(b->jobs);
+    b->jobs = NULL;
+}
+
+static int batches_init(chunk_batches *b, int threads, const int_codec *codec, size_t chunk_values, unsigned flags,
+                        int decode, int text) {
+    b->threads = threads;
+    b->jobs = (chunk_job *)calloc(2 * (size_t)threads, sizeof(chunk_job));
+    if (b->jobs == NULL) return -1;
+    for (int i = 0; i < 2 * threads; i++) {
+        chunk_job *job = &b->jobs[i];
+        job->codec = codec;
+        job->text = text;
+        job->flags = flags;
+        job->values = (uint32_t *)malloc(chunk_values * sizeof(uint32_t));
+        job->packed = (uint8_t *)malloc(codec->bound(chunk_values));
+        if (decode) job->output = (uint8_t *)malloc(chunk_values * 11);
+        if (job->values == NULL || job->packed == NULL || (decode && job->output == NULL)) {
+            batches_free(b);
+            return -1;
+        }
+    }
+    return 0;
+}
+
+// -- Кодирование --
+
+typedef struct chunk_index
+{
+    uint8_t *entries;       // Записи оглавления в формате файла
+    size_t count, cap;
+} chunk_index;
+
+static int index_add(chunk_index *idx, uint64_t offset, size_t count, size_t size) {
+    if (idx->count == idx->cap) {
+        size_t cap = idx->cap ? idx->cap * 2 : 256;
+        uint8_t *entries = (uint8_t *)realloc(idx->entries, cap * CONTAINER_ENTRY);
+        if (entries == NULL) return -1;
+        idx->entries = entries;
+        idx->cap = cap;
+    }
+    uint8_t *e = idx->entries + idx->count++ * CONTAINER_ENTRY;
+    store_le64(e, offset);
+    store_le32(e + 8, (uint32_t)count);
+    store_le32(e + 12, (uint32_t)size);
+    return 0;
+}
+
+// Записывает кадры партии; offset - позиция в выходном файле
+static int write_frames(FILE *out, chunk_job *jobs, int count, chunk_index *idx, uint64_t *offset) {
+    for (int i = 0; i < count; i++) {
+        uint8_t frame[CONTAINER_FRAME];
+        store_le32(frame, (uint32_t)jobs[i].count);
+        store_le32(frame + 4, (uint32_t)jobs[i].size);
+        if (index_add(idx, *offset, jobs[i].count, jobs[i].size) != 0 ||
+            fwrite(frame, 1, sizeof(frame), out) != sizeof(frame) ||
+            fwrite(jobs[i].packed, 1, jobs[i].size, out) != jobs[i].size)
+            return -1;
+        *offset += CONTAINER_FRAME + jobs[i].size;
+    }
+    return 0;
+}
+
+// Читает до threads порций во вторую партию; возвращает их число
+static int read_batch(int_reader *r, chunk_job *jobs, int threads, size_t chunk_values) {
+    int count = 0;
+    while (count < threads) {
+        jobs[count].count = read_ints(r, jobs[count].values, chunk_values);
+        if (jobs[count].count == 0) break;
+        count++;
+    }
+    return count;
+}
+
+// nekal -e: файл чисел -> контейнер; gaps - хранить разности неубывающих чисел
+int container_encode(const char *in_path, const char *out_path, const int_codec *codec, int text, int gaps,
+                     size_t chunk_values, int threads) {
+    if (threads > CONTAINER_MAX_THREADS) threads = CONTAINER_MAX_THREADS;
+    if (threads < 1) threads = 1;
+    int_codecs_init();
+    FILE *in = fopen(in_path, text ? "r" : "rb");
+    FILE *out = fopen(out_path, "wb");
+    int_reader reader = { in, text, (uint8_t *)malloc(TEXT_BUFFER_SIZE), 0, 0, 0, 0, 0 };
+    chunk_batches batches = { NULL, threads };
+    chunk_index idx = { NULL, 0, 0 };
+    unsigned flags = (gaps ? CONTAINER_GAPS : 0) | (codec->positive ? CONTAINER_SHIFT : 0);
+    int status = (in == NULL || out == NULL || reader.buf == NULL ||
+                  batches_init(&batches, threads, codec, chunk_values, flags, 0, text) != 0) ? -1 : 0;
+
+    uint8_t header[CONTAINER_HEADER];
+    memcpy(header, CONTAINER_MAGIC, 8);
+    store_le32(header + 8, (uint32_t)(codec - int_codecs));
+    store_le32(header + 12, (uint32_t)chunk_values);
+    store_le32(header + 16, flags);
+    if (status == 0 && fwrite(header, 1, sizeof(header), out) != sizeof(header)) status = -1;
+
+    uint64_t offset = CONTAINER_HEADER, total = 0;
+    uint64_t start = bench_now();
+    if (status == 0) {
+        chunk_job *current = batches.jobs, *previous = batches.jobs + threads;
+        int current_count = read_batch(&reader, current, threads, chunk_values), previous_count = 0;
+        while (status == 0 && (current_count > 0 || previous_count > 0)) {
+            task_group group;
+            start_tasks(&group, encode_chunk_run, current, sizeof(chunk_job), current_count);
+            if (previous_count > 0 && write_frames(out, previous, previous_count, &idx, &offset) != 0) status = -1;
+            int next_count = (status == 0 && current_count == threads && !reader.error)
+                                 ? read_batch(&reader, previous, threads, chunk_values) : 0;
+            join_tasks(&group);
+            for (int i = 0; i < current_count; i++) {
+                if (current[i].result == -2) {
+                    printf("Порция %zu: числа не упорядочены по возрастанию\n", idx.count + (size_t)i);
+                    status = -1;
+                } else if (current[i].result != 0) {
+                    printf("Порция %zu: значения не представимы кодом %s\n", idx.count + (size_t)i, codec->name);
+                    status = -1;
+                }
+                total += current[i].count;
+            }
+            chunk_job *t = previous;
+            previous = current;
+            previous_count = current_count;
+            current = t;
+            current_count = next_count;
+        }
+        if (reader.error) status = -1;
+    }
+
+    if (status == 0) {
+        uint8_t trailer[CONTAINER_TRAILER];
+        store_le64(trailer, idx.count);
+        store_le64(trailer + 8, offset);
+        memcpy(trailer + 16, CONTAINER_END, 8);
+        if (fwrite(idx.entries, CONTAINER_ENTRY, idx.count, out) != idx.count ||
+            fwrite(trailer, 1, sizeof(trailer), out) != sizeof(trailer))
+            status = -1;
+    }
+    if (out != NULL && fclose(out) != 0) status = -1;
+    if (in != NULL) fclose(in);
+    if (status != 0 && out != NULL) remove(out_path);
+    if (status == 0) {
+        double seconds = (double)(bench_now() - start) / 1e9;
+        uint64_t size = offset + idx.count * CONTAINER_ENTRY + CONTAINER_TRAILER;
+        printf("%s: %llu чисел, %zu порций, %llu байт (%.3f бит/число), %.1f Mint/s\n", codec->name,
+               (unsigned long long)total, idx.count, (unsigned long long)size,
+               total ? (double)size * 8 / (double)total : 0.0, bench_rate((size_t)total, (uint64_t)(seconds * 1e9)));
+    }
+    batches_free(&batches);
+    free(reader.buf);
+    free(idx.entries);
+    return status;
+}
+
+// -- Декодирование --
+
+typedef struct container
+{
+    FILE *fp;
+    const int_codec *codec;
+    size_t chunk_values;
+    unsigned flags;
+    uint64_t chunks;
+    uint8_t *entries;       // Оглавление
+    uint64_t position;      // Текущая позиция файла (UINT64_MAX - неизвестна)
+} container;
+
+static void container_close(container *c) {
+    if (c->fp != NULL) fclose(c->fp);
+    free(c->entries);
+    c->fp = NULL;
+    c->entries = NULL;
+}
+
+// Открывает контейнер и читает оглавление по концовке
+int container_open(container *c, const char *path) {
+    memset(c, 0, sizeof(*c));
+    c->fp = fopen(path, "rb");
+    if (c->fp == NULL) return -1;
+    uint8_t header[CONTAINER_HEADER], trailer[CONTAINER_TRAILER];
+    if (fread(header, 1, sizeof(header), c->fp) != sizeof(header) || memcmp(header, CONTAINER_MAGIC, 8) != 0 ||
+        file_seek(c->fp, -(file_offset)CONTAINER_TRAILER, SEEK_END) != 0 ||
+        fread(trailer, 1, sizeof(trailer), c->fp) != sizeof(trailer) || memcmp(trailer + 16, CONTAINER_END, 8) != 0) {
+        container_close(c);
+        return -1;
+    }
+    uint32_t codec = load_le32(header + 8);
+    c->chunk_values = load_le32(header + 12);
+    c->flags = load_le32(header + 16);
+    c->chunks = load_le64(trailer);
+    uint64_t index_offset = load_le64(trailer + 8);
+    if (codec >= INT_CODEC_COUNT || (c->flags & ~(CONTAINER_GAPS | CONTAINER_SHIFT)) != 0 || c->chunk_values == 0 || c->chunk_values > CHUNK_VALUES_MAX ||
+        c->chunks > (UINT64_MAX - index_offset) / CONTAINER_ENTRY) {
+        container_close(c);
+        return -1;
+    }
+    c->codec = &int_codecs[codec];
+    c->position = UINT64_MAX;
+    c->entries = (uint8_t *)malloc(c->chunks ? c->chunks * CONTAINER_ENTRY : 1);
+    if (c->entries == NULL || file_seek(c->fp, (file_offset)index_offset, SEEK_SET) != 0 ||
+        fread(c->entries, CONTAINER_ENTRY, c->chunks, c->fp) != c->chunks) {
+        container_close(c);
+        return -1;
+    }
+    for (uint64_t k = 0; k < c->chunks; k++) {
+        const uint8_t *e = c->entries + k * CONTAINER_ENTRY;
+        if (load_le32(e + 8) > c->chunk_values || load_le32(e + 12) > c->codec->bound(c->chunk_values)) {
+            container_close(c);
+            return -1;
+        }
+    }
+    return 0;
+}
+
+// Читает кадр порции k в задание
+static int read_frame(container *c, uint64_t k, chunk_job *job) {
+    const uint8_t *e = c->entries + k * CONTAINER_ENTRY;
+    uint8_t frame[CONTAINER_FRAME];
+    uint64_t offset = load_le64(e);
+    job->count = load_le32(e + 8);
+    job->size = load_le32(e + 12);
+    // Подряд идущие кадры читаются без перемещения по файлу
+    if (offset != c->position && file_seek(c->fp, (file_offset)offset, SEEK_SET) != 0) return -1;
+    c->position = UINT64_MAX;
+    if (fread(frame, 1, sizeof(frame), c->fp) != sizeof(frame) ||
+        load_le32(frame) != job->count || load_le32(frame + 4) != job->size ||
+        fread(job->packed, 1, job->size, c->fp) != job->size)
+        return -1;
+    c->position = offset + CONTAINER_FRAME + job->size;
+    return 0;
+}
+
+// nekal -d: контейнер -> файл чисел; chunk >= 0 - только одна порция
+int container_decode(const char *in_path, const char *out_path, long long chunk, int text, int threads) {
+    if (threads > CONTAINER_MAX_THREADS) threads = CONTAINER_MAX_THREADS;
+    if (threads < 1) threads = 1;
+    int_codecs_init();
+    container c;
+    if (container_open(&c, in_path) != 0) {
+        printf("Файл %s - не контейнер nekal или повреждён\n", in_path);
+        return -1;
+    }
+    uint64_t first = 0, last = c.chunks;
+    if (chunk >= 0) {
+        if ((uint64_t)chunk >= c.chunks) {
+            printf("В контейнере %llu порций\n", (unsigned long long)c.chunks);
+            container_close(&c);
+            return -1;
+        }
+        first = (uint64_t)chunk;
+        last = first + 1;
+        threads = 1;
+    }
+
+    FILE *out = fopen(out_path, text ? "w" : "wb");
+    chunk_batches batches = { NULL, threads };
+    int status = (out == NULL || batches_init(&batches, threads, c.codec, c.chunk_values, c.flags, 1, text) != 0) ? -1 : 0;
+    uint64_t total = 0, start = bench_now();
+    chunk_job *current = batches.jobs, *previous = batches.jobs + threads;
+    int current_count = 0, previous_count = 0;
+    uint64_t next = first;
+
+    while (status == 0 && next < last && current_count < threads)
+        status = read_frame(&c, next++, &current[current_count++]);
+    while (status == 0 && (current_count > 0 || previous_count > 0)) {
+        task_group group;
+        start_tasks(&group, decode_chunk_run, current, sizeof(chunk_job), current_count);
+        for (int i = 0; status == 0 && i < previous_count; i++)
+            if (fwrite(previous[i].output, 1, previous[i].output_len, out) != previous[i].output_len) status = -1;
+        int next_count = 0;
+        while (status == 0 && next < last && next_count < threads)
+            status = read_frame(&c, next++, &previous[next_count++]);
+        join_tasks(&group);
+        for (int i = 0; i < current_count; i++) {
+            if (current[i].result != 0) status = -1;
+            total += current[i].count;
+        }
+        chunk_job *t = previous;
+        previous = current;
+        previous_count = current_count;
+        current = t;
+        current_count = next_count;
+    }
+    if (out != NULL && fclose(out) != 0) status = -1;
+    if (status != 0 && out != NULL) remove(out_path);
+    if (status == 0)
+        printf("%s: %llu чисел, %.1f Mint/s\n", c.codec->name, (unsigned long long)total,
+               bench_rate((size_t)total, bench_now() - start));
+    else
+        printf("Ошибка чтения порций контейнера\n");
+    batches_free(&batches);
+    container_close(&c);
+    return status;
+}
+
+// nekal                    - таблица кодов для чисел 0..256
+// nekal -b [N]             - проверка и замер кодирования N чисел (по умолчанию 10 млн)
+// nekal -c [N]             - сравнение всех кодеков на списке из N номеров
+// nekal -e in out [-g]     - файл чисел -> контейнер; -g - числа неубывающие
+//                            (например, номера), хранить разности соседних
+// nekal -d in out          - контейнер -> файл чисел
+// Ключи -e/-d: -a - текстовый файл чисел (иначе 32-битные little-endian),
+// -t N - потоков, -m код - fixed, gamma, delta (по умолчанию), omega, varint,
+// bitpack, ef; -n N - чисел в порции; -k K - декодировать только порцию K.
+// Коды Элиаса не представляют 0, поэтому для них хранится v + 1.
+int main(int argc, char *argv[]) {
+    if (argc > 1 && (strcmp(argv[1], "-b") == 0 || strcmp(argv[1], "-c") == 0)) {
+        size_t count = argc > 2 ? (size_t)strtoull(argv[2], NULL, 10) : 10000000;
+        return argv[1][1] == 'b' ? run_benchmark(count) : run_comparison(count);
+    }
+    if (argc > 1 && (strcmp(argv[1], "-e") == 0 || strcmp(argv[1], "-d") == 0)) {
+        const char *paths[2] = { NULL, NULL };
+        const int_codec *codec = find_codec("delta");
+        size_t chunk_values = CHUNK_VALUES_DEFAULT;
+        int text = 0, gaps = 0, threads = cpu_count(), path_count = 0;
+        long long chunk = -1;
+        for (int i = 2; i < argc; i++) {
+            if (strcmp(argv[i], "-a") == 0) {
+                text = 1;
+            } else if (strcmp(argv[i], "-g") == 0) {
+                gaps = 1;
+            } else if (strcmp(argv[i], "-t") == 0 && i + 1 < argc) {
+                threads = atoi(argv[++i]);
+            } else if (strcmp(argv[i], "-m") == 0 && i + 1 < argc) {
+                codec = find_codec(argv[++i]);
+                if (codec == NULL) {
+                    printf("Неизвестный код %s\n", argv[i]);
+                    return 1;
+                }
+            } else if (strcmp(argv[i], "-n") == 0 && i + 1 < argc) {
+                chunk_values = (size_t)strtoull(argv[++i], NULL, 10);
+            } else if (strcmp(argv[i], "-k") == 0 && i + 1 < argc) {
+                chunk = atoll(argv[++i]);
+            } else if (path_count < 2) {
+                paths[path_count++] = argv[i];
+            }
+        }
+        if (path_count < 2 || chunk_values == 0 || chunk_values > CHUNK_VALUES_MAX) {
+            printf("Использование: nekal -e|-d входной выходной [-a] [-g] [-t N] [-m код] [-n N] [-k K]\n");
+            return 1;
+        }
+        if (gaps && codec->monotone) {
+            printf("Код %s сам хранит неубывающие числа, -g не нужен\n", codec->name);
+            return 1;
+        }
+        int result = argv[1][1] == 'e'
+                         ? container_encode(paths[0], paths[1], codec, text, gaps, chunk_values, threads)
+                         : container_decode(paths[0], paths[1], chunk, text, threads);
+        if (result != 0) {
+            printf("Ошибка преобразования в %s!\n", paths[1]);
+            return 1;
+        }
+        return 0;
+    }
+
     int max_num = 256;
-    char fv[64], gamma[64], omega[64];
-    printf("===============================================================================\n");
-    printf("| %-5s | %-18s | %-20s | %-20s |\n", "N", "Fixed+Var", "Elias Gamma", "Elias Omega");
-    printf("|-------|--------------------|----------------------|----------------------|\n");
+    char fv[64], gamma[64], delta[64], omega[64];
+    printf("====================================================================================================\n");
+    printf("| %-5s | %-18s | %-20s | %-20s | %-20s |\n", "N", "Fixed+Var", "Elias Gamma", "Elias Delta", "Elias Omega");
+    printf("|-------|--------------------|----------------------|----------------------|----------------------|\n");
 
     for (int i = 0; i <= max_num; i++) {
         code_fixed_variable(i, fv);
         code_elias_gamma(i, gamma);
+        code_elias_delta(i, delta);
         code_elias_omega(i, omega);
         
-        printf("| %-5d | %-18s | %-20s | %-20s |\n", i, fv, gamma, omega);
+        printf("| %-5d | %-18s | %-20s | %-20s | %-20s |\n", i, fv, gamma, delta, omega);
     }
     
-    printf("===============================================================================\n");
+    printf("====================================================================================================\n");
     return 0;
-}
\ No newline at end of file
+}
@@ -0,0 +1,72 @@
+// Формат записи файла базы (testBase3.dat) - общий для course.c и saod.c.
+// Запись занимает ровно 64 байта без выравнивания: строки в CP866 дополнены
+// пробелами, последний байт строкового поля - '\0'. Файл читается прямо как
+// массив record, без копирования записей.
+#ifndef RECORD_H
+#define RECORD_H
+
+#include <stddef.h>
+#include <assert.h>
+
+#define DEPOSITOR_LEN 30
+#define DATE_LEN 10
+#define LAWYER_LEN 22
+
+typedef struct record
+{
+    char depositor[DEPOSITOR_LEN];  // ФИО вкладчика (30 символов)
+    unsigned short amount;          // Сумма вклада (unsigned short int)
+    char date[DATE_LEN];            // Дата вклада (10 символов)
+    char lawyer[LAWYER_LEN];        // ФИО адвоката (22 символа)
+} record;
+
+static_assert(sizeof(unsigned short) == 2, "amount must be 16-bit");
+static_assert(offsetof(record, depositor) == 0, "depositor offset");
+static_assert(offsetof(record, amount) == 30, "amount offset");
+static_assert(offsetof(record, date) == 32, "date offset");
+static_assert(offsetof(record, lawyer) == 42, "lawyer offset");
+static_assert(sizeof(record) == 64, "record must be 64 bytes");
+
+// Строковое поле записи без завершающих пробелов и '\0' (в CP866)
+typedef struct field_view
+{
+    const char *data;
+    size_t len;
+} field_view;
+
+static inline field_view field_trim(const char *field, size_t field_len) {
+    field_view v = { field, 0 };
+    while (v.len < field_len && field[v.len] != '\0') v.len++;
+    while (v.len > 0 && field[v.len - 1] == ' ') v.len--;
+    return v;
+}
+
+static inline field_view record_depositor(const record *rec) {
+    return field_trim(rec->depositor, DEPOSITOR_LEN);
+}
+
+static inline field_view record_date(const record *rec) {
+    return field_trim(rec->date, DATE_LEN);
+}
+
+static inline field_view record_lawyer(const record *rec) {
+    return field_trim(rec->lawyer, LAWYER_LEN);
+}
+
+static inline unsigned record_amount(const record *rec) {
+    return rec->amount;
+}
+
+// Записи, лежащие в памяти подряд (отображённый или прочитанный целиком файл)
+typedef struct record_view
+{
+    const record *records;
+    size_t count;           // Неполная запись в конце файла отбрасывается
+} record_view;
+
+static inline record_view record_view_of(const void *data, size_t size) {
+    record_view v = { (const record *)data, size / sizeof(record) };
+    return v;
+}
+
+#endif
@@ -1,130 +1,4183 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <stdarg.h>
+#include <stdint.h>
+#include <stddef.h>
+
+#include <pthread.h>
+#include <sys/stat.h>
+
+#include "record.h"
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#include <immintrin.h>
+#define HAVE_X86_SIMD 1
+#endif
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#endif
 
 #define PAGE_SIZE 20
+#define PARALLEL_SORT_MIN 65536  // Меньшие базы сортируются в одном потоке
+#define INDEX_MAGIC "SAODIDX1"
+#define EXTERNAL_MEMORY_MB 256   // Память внешней сортировки по умолчанию
+#define EXTERNAL_FAN_IN 64       // Сколько серий сливается за один проход
+
+// Файл, отображённый в память только для чтения
+typedef struct file_map
+{
+    const void *data;       // NULL для пустого файла
+    size_t size;            // Размер отображения в байтах
+#ifdef _WIN32
+    HANDLE file;
+    HANDLE mapping;
+#else
+    int fd;
+#endif
+} file_map;
+
+// Отображает файл в память. Время не зависит от размера файла,
+// страницы подгружаются ОС по мере обращения. Возвращает 0 при успехе.
+int map_file(file_map *map, const char *path) {
+    memset(map, 0, sizeof(*map));
+#ifdef _WIN32
+    map->file = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, NULL,
+                            OPEN_EXISTING, FILE_FLAG_RANDOM_ACCESS, NULL);
+    if (map->file == INVALID_HANDLE_VALUE) return -1;
+
+    LARGE_INTEGER file_size;
+    if (!GetFileSizeEx(map->file, &file_size)) {
+        CloseHandle(map->file);
+        return -1;
+    }
+    map->size = (size_t)file_size.QuadPart;
+    if (map->size == 0) return 0;
+
+    map->mapping = CreateFileMappingA(map->file, NULL, PAGE_READONLY, 0, 0, NULL);
+    if (map->mapping == NULL) {
+        CloseHandle(map->file);
+        return -1;
+    }
+    map->data = MapViewOfFile(map->mapping, FILE_MAP_READ, 0, 0, 0);
+    if (map->data == NULL) {
+        CloseHandle(map->mapping);
+        CloseHandle(map->file);
+        return -1;
+    }
+#else
+    map->fd = open(path, O_RDONLY);
+    if (map->fd < 0) return -1;
+
+    struct stat st;
+    if (fstat(map->fd, &st) != 0) {
+        close(map->fd);
+        return -1;
+    }
+    map->size = (size_t)st.st_size;
+    if (map->size == 0) return 0;
+
+    void *addr = mmap(NULL, map->size, PROT_READ, MAP_SHARED, map->fd, 0);
+    if (addr == MAP_FAILED) {
+        close(map->fd);
+        return -1;
+    }
+    map->data = addr;
+#endif
+    return 0;
+}
+
+void unmap_file(file_map *map) {
+#ifdef _WIN32
+    if (map->data) UnmapViewOfFile(map->data);
+    if (map->mapping) CloseHandle(map->mapping);
+    if (map->file && map->file != INVALID_HANDLE_VALUE) CloseHandle(map->file);
+#else
+    if (map->data) munmap((void *)map->data, map->size);
+    if (map->fd >= 0) close(map->fd);
+#endif
+    memset(map, 0, sizeof(*map));
+#ifndef _WIN32
+    map->fd = -1;
+#endif
+}
+
+// База записей: отображённый файл без копирования
+typedef struct record_db
+{
+    const record *records;  // Записи прямо в отображённой памяти
+    size_t count;           // Количество целых записей в файле
+    file_map map;
+} record_db;
+
+int db_open(record_db *db, const char *path) {
+    if (map_file(&db->map, path) != 0) return -1;
+    record_view view = record_view_of(db->map.data, db->map.size);
+    db->records = view.records;
+    db->count = view.count;
+    return 0;
+}
+
+void db_close(record_db *db) {
+    unmap_file(&db->map);
+    db->records = NULL;
+    db->count = 0;
+}
+
+// Функция сравнения для сортировки по ФИО адвоката и сумме вклада
+int compare_records(const void *a, const void *b) {
+    const record *rec_a = (const record *)a;
+    const record *rec_b = (const record *)b;
+    
+    // Сравниваем ФИО адвоката
+    int lawyer_cmp = strncmp(rec_a->lawyer, rec_b->lawyer, LAWYER_LEN);
+    if (lawyer_cmp != 0) {
+        return lawyer_cmp;
+    }
+    
+    // Если ФИО адвоката совпадают, сравниваем сумму вклада
+    if (rec_a->amount < rec_b->amount) return -1;
+    if (rec_a->amount > rec_b->amount) return 1;
+    return 0;
+}
+
+// Отображение доступно только для чтения, поэтому сортируется не сама база,
+// а массив номеров записей (перестановка)
+static const record *sort_base;
+
+int compare_order(const void *a, const void *b) {
+    return compare_records(&sort_base[*(const uint32_t *)a],
+                           &sort_base[*(const uint32_t *)b]);
+}
+
+// Сортировка по (lawyer, amount) сводится к сортировке 64-битных чисел:
+// различные ФИО адвокатов собираются в хеш-таблицу и сортируются один раз,
+// после чего ключ записи - это ранг ФИО в этом словаре и сумма вклада.
+// Сравнение таких ключей как чисел совпадает с compare_records.
+typedef struct sort_key
+{
+    uint64_t key;           // (ранг ФИО адвоката << 16) | сумма вклада
+    uint32_t idx;           // Номер записи в файле
+} sort_key;
+
+#define RADIX_BITS 11
+#define RADIX_SIZE (1u << RADIX_BITS)
+#define RADIX_DIGITS ((64 + RADIX_BITS - 1) / RADIX_BITS)
+
+// Приводит ФИО адвоката к фиксированному виду: strncmp останавливается на '\0',
+// поэтому всё после него обнуляется, и memcmp даёт тот же порядок
+void normalize_lawyer(const char *lawyer, unsigned char *out) {
+    size_t i = 0;
+    for (; i < LAWYER_LEN && lawyer[i] != '\0'; i++) out[i] = (unsigned char)lawyer[i];
+    for (; i < LAWYER_LEN; i++) out[i] = 0;
+}
+
+// Словарь различных строк фиксированной длины key_len (ФИО адвокатов,
+// слова ФИО вкладчиков), открытая адресация
+typedef struct name_dict
+{
+    unsigned char *names;   // Различные строки подряд в порядке появления
+    size_t key_len;
+    uint32_t count;
+    uint32_t capacity;
+    uint32_t *slots;        // Номер строки + 1, 0 - пустая ячейка
+    size_t mask;
+} name_dict;
+
+static const unsigned char *name_dict_key(const name_dict *dict, uint32_t id) {
+    return dict->names + (size_t)id * dict->key_len;
+}
+
+static uint64_t hash_name(const unsigned char *name, size_t len) {
+    static const uint64_t mul[4] = {0x9E3779B97F4A7C15ULL, 0xC2B2AE3D27D4EB4FULL,
+                                    0x165667B19E3779F9ULL, 0x27D4EB2F165667C5ULL};
+    uint64_t h = 0;
+    for (size_t i = 0, k = 0; i < len; i += 8, k = (k + 1) & 3) {
+        uint64_t w = 0;
+        memcpy(&w, name + i, len - i < 8 ? len - i : 8);
+        h ^= w * mul[k];
+    }
+    return h ^ (h >> 32);
+}
+
+static int name_dict_init(name_dict *dict, size_t key_len) {
+    dict->key_len = key_len;
+    dict->count = 0;
+    dict->capacity = 512;
+    dict->mask = 1023;
+    dict->slots = (uint32_t *)calloc(dict->mask + 1, sizeof(uint32_t));
+    dict->names = (unsigned char *)malloc((size_t)dict->capacity * key_len);
+    return (dict->slots != NULL && dict->names != NULL) ? 0 : -1;
+}
+
+static void name_dict_free(name_dict *dict) {
+    free(dict->slots);
+    free(dict->names);
+}
+
+// Удваивает таблицу и массив строк, когда таблица заполнена наполовину
+static int name_dict_grow(name_dict *dict) {
+    size_t size = (dict->mask + 1) * 2;
+    uint32_t *slots = (uint32_t *)calloc(size, sizeof(uint32_t));
+    unsigned char *names = (unsigned char *)realloc(dict->names, (size_t)dict->capacity * 2 * dict->key_len);
+    if (slots == NULL || names == NULL) {
+        free(slots);
+        if (names != NULL) dict->names = names;
+        return -1;
+    }
+    dict->names = names;
+    dict->capacity *= 2;
+    dict->mask = size - 1;
+    for (uint32_t id = 0; id < dict->count; id++) {
+        size_t slot = (size_t)hash_name(name_dict_key(dict, id), dict->key_len) & dict->mask;
+        while (slots[slot] != 0) slot = (slot + 1) & dict->mask;
+        slots[slot] = id + 1;
+    }
+    free(dict->slots);
+    dict->slots = slots;
+    return 0;
+}
+
+// Возвращает номер строки в словаре, добавляя её при необходимости,
+// или UINT32_MAX при нехватке памяти
+static uint32_t name_dict_insert(name_dict *dict, const unsigned char *name) {
+    size_t slot = (size_t)hash_name(name, dict->key_len) & dict->mask;
+    while (dict->slots[slot] != 0) {
+        uint32_t id = dict->slots[slot] - 1;
+        if (memcmp(name_dict_key(dict, id), name, dict->key_len) == 0) return id;
+        slot = (slot + 1) & dict->mask;
+    }
+    if (dict->count == dict->capacity) {
+        if (name_dict_grow(dict) != 0) return UINT32_MAX;
+        slot = (size_t)hash_name(name, dict->key_len) & dict->mask;
+        while (dict->slots[slot] != 0) slot = (slot + 1) & dict->mask;
+    }
+    memcpy(dict->names + (size_t)dict->count * dict->key_len, name, dict->key_len);
+    dict->slots[slot] = dict->count + 1;
+    return dict->count++;
+}
+
+// Ранги строк словаря в порядке memcmp: rank[id]. by_name - рабочий массив
+// из dict->count элементов (в нём остаются номера строк по возрастанию).
+// Номера сортируются слиянием снизу вверх, вторым буфером служит rank.
+// Словарь передаётся явно, без глобального состояния, потому что
+// radix_sort_order вызывается из нескольких потоков сразу.
+static void name_dict_ranks(const name_dict *dict, uint32_t *by_name, uint32_t *rank) {
+    size_t n = dict->count;
+    for (uint32_t id = 0; id < dict->count; id++) by_name[id] = id;
+
+    uint32_t *src = by_name, *dst = rank;
+    for (size_t width = 1; width < n; width *= 2) {
+        for (size_t lo = 0; lo < n; lo += 2 * width) {
+            size_t mid = lo + width < n ? lo + width : n;
+            size_t hi = lo + 2 * width < n ? lo + 2 * width : n;
+            size_t i = lo, j = mid, k = lo;
+            while (i < mid && j < hi) {
+                if (memcmp(name_dict_key(dict, src[j]), name_dict_key(dict, src[i]), dict->key_len) < 0)
+                    dst[k++] = src[j++];
+                else
+                    dst[k++] = src[i++];
+            }
+            while (i < mid) dst[k++] = src[i++];
+            while (j < hi) dst[k++] = src[j++];
+        }
+        uint32_t *swap = src;
+        src = dst;
+        dst = swap;
+    }
+    if (src != by_name) memcpy(by_name, src, n * sizeof(uint32_t));
+    for (uint32_t r = 0; r < dict->count; r++) rank[by_name[r]] = r;
+}
+
+// LSD-проходы по массиву ключей: counts - обнулённые гистограммы
+// (RADIX_DIGITS * RADIX_SIZE). Все гистограммы считаются за один проход, а
+// разряды, одинаковые у всех ключей, пропускаются. Возвращает keys или tmp -
+// тот буфер, в котором оказался отсортированный массив.
+static sort_key *radix_sort_keys(sort_key *keys, sort_key *tmp, uint32_t *counts, size_t total_records) {
+    for (size_t i = 0; i < total_records; i++)
+        for (int d = 0; d < RADIX_DIGITS; d++)
+            counts[(size_t)d * RADIX_SIZE + ((keys[i].key >> (d * RADIX_BITS)) & (RADIX_SIZE - 1))]++;
+
+    for (int d = 0; d < RADIX_DIGITS; d++) {
+        uint32_t *count = counts + (size_t)d * RADIX_SIZE;
+        int shift = d * RADIX_BITS;
+        if (count[(keys[0].key >> shift) & (RADIX_SIZE - 1)] == total_records) continue;
+
+        // Префиксные суммы -> начальные позиции корзин
+        uint32_t pos = 0;
+        for (unsigned b = 0; b < RADIX_SIZE; b++) {
+            uint32_t c = count[b];
+            count[b] = pos;
+            pos += c;
+        }
+        for (size_t i = 0; i < total_records; i++)
+            tmp[count[(keys[i].key >> shift) & (RADIX_SIZE - 1)]++] = keys[i];
+
+        sort_key *swap = keys;
+        keys = tmp;
+        tmp = swap;
+    }
+
+    return keys;
+}
+
+// Поразрядная (LSD) сортировка перестановки по ключу (lawyer, amount).
+// Все гистограммы считаются за один проход, а разряды, одинаковые у всех
+// записей, пропускаются. Сортировка устойчива, поэтому равные записи
+// остаются в порядке файла. Возвращает 0 при успехе, -1 при нехватке памяти.
+int radix_sort_order(const record *DB, uint32_t *order, size_t total_records) {
+    if (total_records < 2) return 0;
+
+    name_dict dict;
+    int dict_ok = name_dict_init(&dict, LAWYER_LEN);
+    uint32_t *ids = (uint32_t *)malloc(total_records * sizeof(uint32_t));
+    sort_key *keys = (sort_key *)malloc(total_records * sizeof(sort_key));
+    sort_key *tmp = (sort_key *)malloc(total_records * sizeof(sort_key));
+    uint32_t *counts = (uint32_t *)calloc((size_t)RADIX_DIGITS * RADIX_SIZE, sizeof(uint32_t));
+    int result = -1;
+    if (dict_ok != 0 || ids == NULL ||
+        keys == NULL || tmp == NULL || counts == NULL)
+        goto done;
+
+    // Номера ФИО в словаре; каждая запись читается из файла ровно один раз.
+    // Подряд идущие одинаковые ФИО (уже отсортированные данные) не ищутся заново.
+    unsigned char prev[LAWYER_LEN];
+    uint32_t prev_id = UINT32_MAX;
+    for (size_t i = 0; i < total_records; i++) {
+        const record *rec = &DB[order[i]];
+        unsigned char name[LAWYER_LEN];
+        normalize_lawyer(rec->lawyer, name);
+        if (prev_id == UINT32_MAX || memcmp(name, prev, LAWYER_LEN) != 0) {
+            prev_id = name_dict_insert(&dict, name);
+            if (prev_id == UINT32_MAX) goto done;
+            memcpy(prev, name, LAWYER_LEN);
+        }
+        ids[i] = prev_id;
+        keys[i].key = rec->amount;
+        keys[i].idx = order[i];
+    }
+
+    // Ранги ФИО: сортируется только словарь. Хеш-таблица больше не нужна
+    // (в ней не меньше ячеек, чем имён), ранги временно лежат в tmp
+    uint32_t *rank = (uint32_t *)tmp;
+    name_dict_ranks(&dict, dict.slots, rank);
+
+    for (size_t i = 0; i < total_records; i++)
+        keys[i].key |= (uint64_t)rank[ids[i]] << 16;
+
+    // Перестановка применяется один раз
+    const sort_key *sorted = radix_sort_keys(keys, tmp, counts, total_records);
+    for (size_t i = 0; i < total_records; i++) order[i] = sorted[i].idx;
+    result = 0;
+
+done:
+    name_dict_free(&dict);
+    free(ids);
+    free(keys);
+    free(tmp);
+    free(counts);
+    return result;
+}
+
+// ---- Параллельная сортировка ----
+// Перестановка делится на куски по числу потоков, каждый кусок сортируется
+// radix_sort_order в своём потоке, затем куски попарно сливаются. Слияние
+// устойчиво (при равенстве берётся левый кусок), а куски идут в порядке
+// файла, поэтому результат совпадает с однопоточной сортировкой.
+
+// Число ядер процессора
+int cpu_count(void) {
+#ifdef _WIN32
+    SYSTEM_INFO info;
+    GetSystemInfo(&info);
+    return (int)info.dwNumberOfProcessors;
+#else
+    long n = sysconf(_SC_NPROCESSORS_ONLN);
+    return n > 0 ? (int)n : 1;
+#endif
+}
+
+typedef struct sort_task
+{
+    const record *DB;
+    uint32_t *order;
+    size_t count;
+    int result;
+} sort_task;
+
+static void *sort_task_run(void *arg) {
+    sort_task *task = (sort_task *)arg;
+    task->result = radix_sort_order(task->DB, task->order, task->count);
+    return NULL;
+}
+
+// Часть слияния двух отсортированных кусков a и b: позиции [out_begin, out_end)
+// результата
+typedef struct merge_task
+{
+    const record *DB;
+    const uint32_t *a;
+    size_t na;
+    const uint32_t *b;
+    size_t nb;
+    uint32_t *out;
+    size_t out_begin;
+    size_t out_end;
+} merge_task;
+
+// Сколько элементов a попадает в первые k элементов устойчивого слияния
+static size_t merge_corank(const record *DB, const uint32_t *a, size_t na,
+                           const uint32_t *b, size_t nb, size_t k) {
+    size_t lo = (k > nb) ? k - nb : 0;
+    size_t hi = (k < na) ? k : na;
+    while (lo < hi) {
+        size_t i = lo + (hi - lo) / 2;
+        // a[i] идёт раньше b[k-i-1], значит a[i] тоже среди первых k
+        if (compare_records(&DB[a[i]], &DB[b[k - i - 1]]) <= 0)
+            lo = i + 1;
+        else
+            hi = i;
+    }
+    return lo;
+}
+
+static void *merge_task_run(void *arg) {
+    merge_task *task = (merge_task *)arg;
+    size_t i = merge_corank(task->DB, task->a, task->na, task->b, task->nb, task->out_begin);
+    size_t j = task->out_begin - i;
+    size_t i_end = merge_corank(task->DB, task->a, task->na, task->b, task->nb, task->out_end);
+    size_t j_end = task->out_end - i_end;
+    uint32_t *out = task->out + task->out_begin;
+
+    while (i < i_end && j < j_end) {
+        if (compare_records(&task->DB[task->b[j]], &task->DB[task->a[i]]) < 0)
+            *out++ = task->b[j++];
+        else
+            *out++ = task->a[i++];
+    }
+    while (i < i_end) *out++ = task->a[i++];
+    while (j < j_end) *out++ = task->b[j++];
+    return NULL;
+}
+
+// Запускает count задач в отдельных потоках и ждёт их завершения.
+// Если поток создать не удалось, задача выполняется в текущем.
+static void run_tasks(void *(*fn)(void *), void *tasks, size_t task_size, int count) {
+    pthread_t *threads = (pthread_t *)malloc((size_t)count * sizeof(pthread_t));
+    char *started = (char *)calloc((size_t)count, 1);
+    for (int t = 0; t < count; t++) {
+        void *task = (char *)tasks + (size_t)t * task_size;
+        if (threads != NULL && started != NULL && pthread_create(&threads[t], NULL, fn, task) == 0)
+            started[t] = 1;
+        else
+            fn(task);
+    }
+    for (int t = 0; t < count; t++)
+        if (started != NULL && started[t]) pthread_join(threads[t], NULL);
+    free(threads);
+    free(started);
+}
+
+// Сортировка перестановки в thread_count потоках.
+// Возвращает 0 при успехе, -1 при нехватке памяти.
+int parallel_sort_order(const record *DB, uint32_t *order, size_t total_records, int thread_count) {
+    if (thread_count > 64) thread_count = 64;
+    if (thread_count <= 1 || total_records < PARALLEL_SORT_MIN)
+        return radix_sort_order(DB, order, total_records);
+
+    int runs = thread_count;
+    size_t bounds[65];
+    for (int t = 0; t <= runs; t++) bounds[t] = total_records * (size_t)t / (size_t)runs;
+
+    sort_task sorts[64];
+    for (int t = 0; t < runs; t++) {
+        sorts[t].DB = DB;
+        sorts[t].order = order + bounds[t];
+        sorts[t].count = bounds[t + 1] - bounds[t];
+        sorts[t].result = 0;
+    }
+    run_tasks(sort_task_run, sorts, sizeof(sort_task), runs);
+    for (int t = 0; t < runs; t++)
+        if (sorts[t].result != 0) return -1;
+
+    uint32_t *tmp = (uint32_t *)malloc(total_records * sizeof(uint32_t));
+    if (tmp == NULL) return -1;
+
+    uint32_t *src = order, *dst = tmp;
+    merge_task merges[64];
+    while (runs > 1) {
+        int pairs = runs / 2;
+        int parts = thread_count / pairs;
+        if (parts < 1) parts = 1;
+
+        int task_count = 0;
+        for (int r = 0; r < pairs; r++) {
+            size_t a = bounds[2 * r], mid = bounds[2 * r + 1], end = bounds[2 * r + 2];
+            for (int part = 0; part < parts; part++) {
+                merge_task *m = &merges[task_count++];
+                m->DB = DB;
+                m->a = src + a;
+                m->na = mid - a;
+                m->b = src + mid;
+                m->nb = end - mid;
+                m->out = dst + a;
+                m->out_begin = (end - a) * (size_t)part / (size_t)parts;
+                m->out_end = (end - a) * (size_t)(part + 1) / (size_t)parts;
+            }
+        }
+        // Непарный последний кусок переносится как есть
+        if (runs % 2 == 1)
+            memcpy(dst + bounds[runs - 1], src + bounds[runs - 1],
+                   (bounds[runs] - bounds[runs - 1]) * sizeof(uint32_t));
+
+        run_tasks(merge_task_run, merges, sizeof(merge_task), task_count);
+
+        for (int r = 0; r <= pairs; r++) bounds[r] = bounds[2 * r < runs ? 2 * r : runs];
+        bounds[(runs + 1) / 2] = total_records;
+        runs = (runs + 1) / 2;
+
+        uint32_t *swap = src;
+        src = dst;
+        dst = swap;
+    }
+
+    if (src != order) memcpy(order, src, total_records * sizeof(uint32_t));
+    free(tmp);
+    return 0;
+}
+
+// ---- Файл индекса рядом с базой (<база>.idx) ----
+// Хранит отсортированную перестановку, чтобы не сортировать неизменный файл
+// при каждом запуске. Индекс действителен, если совпадают размер, время
+// изменения и хеш содержимого базы, а тело - перестановка номеров записей.
+typedef struct index_header
+{
+    char magic[8];          // INDEX_MAGIC
+    uint64_t record_count;
+    uint64_t file_size;
+    int64_t mtime;
+    uint64_t hash;
+} index_header;
+
+static uint64_t fnv1a(uint64_t h, const unsigned char *data, size_t len) {
+    for (size_t i = 0; i < len; i++) h = (h ^ data[i]) * 1099511628211ULL;
+    return h;
+}
+
+// Хеш содержимого базы. Хешируется весь файл: правка записи на месте не
+// меняет размер, а время изменения можно вернуть, поэтому выборочный хеш
+// пропустил бы устаревший индекс. Файл читается словами по 8 байт, чтобы
+// проверка не была заметно дольше отображения базы.
+uint64_t db_content_hash(const record_db *db) {
+    const unsigned char *data = (const unsigned char *)db->map.data;
+    size_t size = db->map.size, i = 0;
+    uint64_t h = 14695981039346656037ULL;
+    for (; i + sizeof(uint64_t) <= size; i += sizeof(uint64_t)) {
+        uint64_t word;
+        memcpy(&word, data + i, sizeof(word));
+        h = (h ^ word) * 0x9E3779B97F4A7C15ULL;
+        h ^= h >> 29;
+    }
+    return fnv1a(h, data + i, size - i);
+}
+
+static void fill_index_header(index_header *header, const record_db *db, const char *db_path) {
+    struct stat st;
+    memset(header, 0, sizeof(*header));
+    memcpy(header->magic, INDEX_MAGIC, sizeof(header->magic));
+    header->record_count = db->count;
+    header->file_size = db->map.size;
+    header->mtime = (stat(db_path, &st) == 0) ? (int64_t)st.st_mtime : 0;
+    header->hash = db_content_hash(db);
+}
+
+// Заменяет path файлом tmp_path (на Windows rename не перезаписывает файлы)
+int replace_file(const char *tmp_path, const char *path) {
+#ifdef _WIN32
+    return MoveFileExA(tmp_path, path, MOVEFILE_REPLACE_EXISTING) ? 0 : -1;
+#else
+    return rename(tmp_path, path);
+#endif
+}
+
+// Путь к файлу индекса: <база>.idx
+void index_path(const char *db_path, char *out, size_t out_size) {
+    snprintf(out, out_size, "%s.idx", db_path);
+}
+
+// Отображает индекс и проверяет, что он построен для текущего содержимого
+// базы. При успехе *order указывает на перестановку внутри отображения.
+// Проверяет, что order - перестановка номеров 0..count-1 (каждый ровно
+// один раз); один проход с битовой картой
+static int is_permutation(const uint32_t *order, size_t count) {
+    uint64_t *seen = (uint64_t *)calloc(count / 64 + 1, sizeof(uint64_t));
+    if (seen == NULL) return 0;
+    int ok = 1;
+    for (size_t i = 0; i < count && ok; i++) {
+        uint32_t id = order[i];
+        uint64_t bit = 1ULL << (id % 64);
+        ok = id < count && !(seen[id / 64] & bit);
+        if (ok) seen[id / 64] |= bit;
+    }
+    free(seen);
+    return ok;
+}
+
+int index_open(file_map *map, const char *db_path, const record_db *db, const uint32_t **order) {
+    char path[1024];
+    index_path(db_path, path, sizeof(path));
+    if (map_file(map, path) != 0) return -1;
+
+    index_header expected;
+    fill_index_header(&expected, db, db_path);
+    const index_header *header = (const index_header *)map->data;
+    if (map->size != sizeof(index_header) + db->count * sizeof(uint32_t) ||
+        memcmp(header, &expected, sizeof(index_header)) != 0 ||
+        !is_permutation((const uint32_t *)(header + 1), db->count)) {
+        unmap_file(map);
+        return -1;
+    }
+    *order = (const uint32_t *)(header + 1);
+    return 0;
+}
+
+// Сохраняет перестановку во временный файл и переименовывает его в <база>.idx,
+// чтобы другой процесс никогда не увидел недописанный индекс
+int index_save(const char *db_path, const record_db *db, const uint32_t *order) {
+    char path[1024], tmp_path[1040];
+    index_path(db_path, path, sizeof(path));
+    snprintf(tmp_path, sizeof(tmp_path), "%s.tmp", path);
+
+    FILE *fp = fopen(tmp_path, "wb");
+    if (fp == NULL) return -1;
+
+    index_header header;
+    fill_index_header(&header, db, db_path);
+    int ok = fwrite(&header, sizeof(header), 1, fp) == 1 &&
+             fwrite(order, sizeof(uint32_t), db->count, fp) == db->count;
+    ok = (fclose(fp) == 0) && ok;
+    if (ok) ok = replace_file(tmp_path, path) == 0;
+    if (!ok) remove(tmp_path);
+    return ok ? 0 : -1;
+}
+
+// Диапазон [begin, end) в отсортированном порядке записей
+typedef struct record_range
+{
+    size_t begin;
+    size_t end;
+} record_range;
+
+// Поле записи по смещению (offsetof)
+#define RECORD_FIELD(rec, field) ((const char *)(rec) + (field))
+
+// Первая позиция, где первые len байт поля >= prefix
+size_t prefix_lower_bound(const record *DB, const uint32_t *order, size_t total_records,
+                          size_t field, const char *prefix, size_t len) {
+    size_t lo = 0, hi = total_records;
+    while (lo < hi) {
+        size_t mid = lo + (hi - lo) / 2;
+        if (strncmp(RECORD_FIELD(&DB[order[mid]], field), prefix, len) < 0)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+    return lo;
+}
+
+// Первая позиция, где первые len байт поля > prefix
+size_t prefix_upper_bound(const record *DB, const uint32_t *order, size_t total_records,
+                          size_t field, const char *prefix, size_t len) {
+    size_t lo = 0, hi = total_records;
+    while (lo < hi) {
+        size_t mid = lo + (hi - lo) / 2;
+        if (strncmp(RECORD_FIELD(&DB[order[mid]], field), prefix, len) <= 0)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+    return lo;
+}
+
+// Бинарный поиск диапазона записей, у которых строковое поле (смещение field,
+// длина field_len) начинается с prefix. order должен быть отсортирован по strncmp
+// этого поля, тогда такие записи идут подряд.
+record_range find_field_prefix(const record *DB, const uint32_t *order, size_t total_records,
+                               size_t field, size_t field_len, const char *prefix) {
+    size_t len = strlen(prefix);
+    if (len > field_len) len = field_len;
+
+    record_range range;
+    range.begin = prefix_lower_bound(DB, order, total_records, field, prefix, len);
+    range.end = range.begin + prefix_upper_bound(DB, order + range.begin,
+                                                 total_records - range.begin, field, prefix, len);
+    return range;
+}
+
+// Диапазон записей, у которых ФИО адвоката начинается с prefix
+record_range find_lawyer_prefix(const record *DB, const uint32_t *order, size_t total_records,
+                                const char *prefix) {
+    return find_field_prefix(DB, order, total_records, offsetof(record, lawyer),
+                             sizeof(DB->lawyer), prefix);
+}
+
+// ---- Внешняя сортировка файлов больше памяти ----
+// Файл читается кусками, которые помещаются в заданный объём памяти; каждый
+// кусок сортируется radix_sort_order и пишется во временный файл-серию.
+// Затем серии сливаются через двоичную кучу по EXTERNAL_FAN_IN за проход
+// (при большем числе серий - в несколько проходов, соседними группами, чтобы
+// серии каждого уровня оставались в порядке файла). Чтение и запись идут
+// большими блоками. При равенстве ключей берётся серия с меньшим номером,
+// то есть более ранняя часть файла, поэтому порядок совпадает с сортировкой
+// в памяти.
+
+// Байт памяти на запись при сортировке серии: сама запись, перестановка и
+// то, что выделяет radix_sort_order (номера ФИО и два массива ключей).
+// Упорядоченная серия не копируется целиком, а пишется через небольшой
+// буфер из EXTERNAL_STAGE_RECORDS записей.
+#define EXTERNAL_BYTES_PER_RECORD (sizeof(record) + 2 * sizeof(uint32_t) + 2 * sizeof(sort_key))
+#define EXTERNAL_STAGE_RECORDS 4096
+
+// Временный файл серии run уровня слияния level
+static void run_path(const char *out_path, int level, int run, char *buf, size_t size) {
+    snprintf(buf, size, "%s.run%d.%d.tmp", out_path, level, run);
+}
+
+static void remove_runs(const char *out_path, int level, int count) {
+    char path[1100];
+    for (int i = 0; i < count; i++) {
+        run_path(out_path, level, i, path, sizeof(path));
+        remove(path);
+    }
+}
+
+// Источник слияния: серия, читаемая блоками
+typedef struct run_reader
+{
+    FILE *fp;
+    record *buf;
+    size_t cap;
+    size_t count;
+    size_t pos;
+    int run;                // Номер серии: при равенстве ключей меньший идёт первым
+} run_reader;
+
+static int run_reader_next(run_reader *r) {
+    if (++r->pos < r->count) return 1;
+    r->count = fread(r->buf, sizeof(record), r->cap, r->fp);
+    r->pos = 0;
+    return r->count > 0;
+}
+
+static int run_reader_less(const run_reader *a, const run_reader *b) {
+    int cmp = compare_records(&a->buf[a->pos], &b->buf[b->pos]);
+    return cmp < 0 || (cmp == 0 && a->run < b->run);
+}
+
+static void heap_sift_down(run_reader **heap, int size, int i) {
+    for (;;) {
+        int least = i, l = 2 * i + 1, r = l + 1;
+        if (l < size && run_reader_less(heap[l], heap[least])) least = l;
+        if (r < size && run_reader_less(heap[r], heap[least])) least = r;
+        if (least == i) return;
+        run_reader *tmp = heap[i];
+        heap[i] = heap[least];
+        heap[least] = tmp;
+        i = least;
+    }
+}
+
+// Сливает серии first..first+count-1 уровня level в out_path.
+// Возвращает 0 при успехе.
+static int merge_run_files(const char *tmp_prefix, int level, int first, int count,
+                           const char *out_path, size_t budget) {
+    run_reader *readers = (run_reader *)calloc((size_t)count, sizeof(run_reader));
+    run_reader **heap = (run_reader **)malloc((size_t)count * sizeof(run_reader *));
+    size_t cap = budget / sizeof(record) / (size_t)(count + 1);
+    if (cap < 16) cap = 16;
+    record *out_buf = (record *)malloc(cap * sizeof(record));
+    FILE *out = fopen(out_path, "wb");
+    int result = -1, heap_size = 0;
+    if (readers == NULL || heap == NULL || out_buf == NULL || out == NULL) goto done;
+
+    for (int i = 0; i < count; i++) {
+        char path[1100];
+        run_path(tmp_prefix, level, first + i, path, sizeof(path));
+        readers[i].fp = fopen(path, "rb");
+        readers[i].buf = (record *)malloc(cap * sizeof(record));
+        readers[i].cap = cap;
+        readers[i].run = i;
+        if (readers[i].fp == NULL || readers[i].buf == NULL) goto done;
+        readers[i].pos = (size_t)-1;
+        if (run_reader_next(&readers[i])) heap[heap_size++] = &readers[i];
+    }
+    for (int i = heap_size / 2 - 1; i >= 0; i--) heap_sift_down(heap, heap_size, i);
+
+    size_t out_count = 0;
+    while (heap_size > 0) {
+        run_reader *top = heap[0];
+        out_buf[out_count++] = top->buf[top->pos];
+        if (out_count == cap) {
+            if (fwrite(out_buf, sizeof(record), out_count, out) != out_count) goto done;
+            out_count = 0;
+        }
+        if (!run_reader_next(top)) heap[0] = heap[--heap_size];
+        heap_sift_down(heap, heap_size, 0);
+    }
+    if (fwrite(out_buf, sizeof(record), out_count, out) != out_count) goto done;
+    result = 0;
+
+done:
+    if (out != NULL && fclose(out) != 0) result = -1;
+    for (int i = 0; readers != NULL && i < count; i++) {
+        if (readers[i].fp) fclose(readers[i].fp);
+        free(readers[i].buf);
+    }
+    free(readers);
+    free(heap);
+    free(out_buf);
+    return result;
+}
+
+// Сортирует файл записей in_path в out_path, используя не больше
+// memory_mb мегабайт под данные. Возвращает 0 при успехе.
+int external_sort(const char *in_path, const char *out_path, size_t memory_mb) {
+    size_t budget = memory_mb * 1024 * 1024;
+    size_t stage_bytes = EXTERNAL_STAGE_RECORDS * sizeof(record);
+    size_t chunk = budget > stage_bytes ? (budget - stage_bytes) / EXTERNAL_BYTES_PER_RECORD : 0;
+    if (chunk < 1024) chunk = 1024;
+
+    FILE *in = fopen(in_path, "rb");
+    if (in == NULL) return -1;
+    record *buf = (record *)malloc(chunk * sizeof(record));
+    record *sorted = (record *)malloc(stage_bytes);
+    uint32_t *order = (uint32_t *)malloc(chunk * sizeof(uint32_t));
+    int runs = 0, level = 0, result = -1;
+    if (buf == NULL || sorted == NULL || order == NULL) goto done;
+
+    // Серии
+    size_t n;
+    while ((n = fread(buf, sizeof(record), chunk, in)) > 0) {
+        for (size_t i = 0; i < n; i++) order[i] = (uint32_t)i;
+        if (radix_sort_order(buf, order, n) != 0) {
+            sort_base = buf;
+            qsort(order, n, sizeof(uint32_t), compare_order);
+        }
+        char path[1100];
+        run_path(out_path, 0, runs, path, sizeof(path));
+        FILE *run = fopen(path, "wb");
+        if (run == NULL) goto done;
+        runs++;
+        int ok = 1;
+        for (size_t i = 0; ok && i < n; i += EXTERNAL_STAGE_RECORDS) {
+            size_t block = n - i < EXTERNAL_STAGE_RECORDS ? n - i : EXTERNAL_STAGE_RECORDS;
+            for (size_t k = 0; k < block; k++) sorted[k] = buf[order[i + k]];
+            ok = fwrite(sorted, sizeof(record), block, run) == block;
+        }
+        if (fclose(run) != 0 || !ok) goto done;
+        printf("Серия %d: %zu записей\n", runs, n);
+    }
+    free(buf);
+    free(sorted);
+    free(order);
+    buf = sorted = NULL;
+    order = NULL;
+
+    // Слияние соседних групп по EXTERNAL_FAN_IN серий, пока их больше одного прохода
+    while (runs > EXTERNAL_FAN_IN) {
+        int groups = (runs + EXTERNAL_FAN_IN - 1) / EXTERNAL_FAN_IN;
+        for (int g = 0; g < groups; g++) {
+            int first = g * EXTERNAL_FAN_IN;
+            int count = (runs - first < EXTERNAL_FAN_IN) ? runs - first : EXTERNAL_FAN_IN;
+            char path[1100];
+            run_path(out_path, level + 1, g, path, sizeof(path));
+            if (merge_run_files(out_path, level, first, count, path, budget) != 0) {
+                remove_runs(out_path, level + 1, g + 1);
+                goto done;
+            }
+        }
+        remove_runs(out_path, level, runs);
+        level++;
+        runs = groups;
+    }
+    if (runs == 0) {
+        // Пустой вход
+        FILE *out = fopen(out_path, "wb");
+        result = (out != NULL && fclose(out) == 0) ? 0 : -1;
+    } else {
+        result = merge_run_files(out_path, level, 0, runs, out_path, budget);
+    }
+
+done:
+    fclose(in);
+    free(buf);
+    free(sorted);
+    free(order);
+    remove_runs(out_path, level, runs);
+    return result;
+}
+
+// Проверяет, что база уже упорядочена (например, после внешней сортировки)
+int records_sorted(const record *DB, size_t total_records) {
+    for (size_t i = 1; i < total_records; i++)
+        if (compare_records(&DB[i - 1], &DB[i]) > 0) return 0;
+    return 1;
+}
+
+// ---- Добавление записей без пересортировки ----
+// Новые записи дописываются в журнал <база>.delta, а не в саму базу. Журнал
+// невелик, поэтому при загрузке он сортируется в памяти, а каждая новая
+// запись вставляется в его порядок бинарным поиском. Пейджер и поиск по
+// адвокату работают с объединённым порядком базы и журнала: позиция в нём
+// переводится в пару позиций (база, журнал) тем же бинарным поиском, что и
+// при параллельном слиянии, без построения общего массива. Уплотнение (-k)
+// сливает журнал с базой за один линейный проход.
+
+typedef struct delta_log
+{
+    record *records;        // В порядке добавления
+    uint32_t *order;        // Отсортированный порядок записей журнала
+    size_t count;
+    size_t cap;
+} delta_log;
+
+void delta_path(const char *db_path, char *out, size_t out_size) {
+    snprintf(out, out_size, "%s.delta", db_path);
+}
+
+void delta_free(delta_log *d) {
+    free(d->records);
+    free(d->order);
+    memset(d, 0, sizeof(*d));
+}
+
+static int delta_reserve(delta_log *d, size_t count) {
+    if (count <= d->cap) return 0;
+    size_t cap = d->cap ? d->cap : 256;
+    while (cap < count) cap *= 2;
+    record *records = (record *)realloc(d->records, cap * sizeof(record));
+    if (records == NULL) return -1;
+    d->records = records;
+    uint32_t *order = (uint32_t *)realloc(d->order, cap * sizeof(uint32_t));
+    if (order == NULL) return -1;
+    d->order = order;
+    d->cap = cap;
+    return 0;
+}
+
+// Загружает журнал базы (отсутствующий журнал - пустой). Возвращает 0 при успехе.
+int delta_load(delta_log *d, const char *db_path) {
+    char path[1024];
+    memset(d, 0, sizeof(*d));
+    delta_path(db_path, path, sizeof(path));
+    FILE *fp = fopen(path, "rb");
+    if (fp == NULL) return 0;
+
+    record rec;
+    while (fread(&rec, sizeof(record), 1, fp) == 1) {
+        if (delta_reserve(d, d->count + 1) != 0) {
+            fclose(fp);
+            return -1;
+        }
+        d->records[d->count] = rec;
+        d->order[d->count] = (uint32_t)d->count;
+        d->count++;
+    }
+    fclose(fp);
+    return radix_sort_order(d->records, d->order, d->count);
+}
+
+// Дописывает запись в журнал на диске и в отсортированный порядок в памяти.
+// Равные записи остаются в порядке добавления.
+int delta_append(delta_log *d, const char *db_path, const record *rec) {
+    char path[1024];
+    delta_path(db_path, path, sizeof(path));
+    if (delta_reserve(d, d->count + 1) != 0) return -1;
+
+    FILE *fp = fopen(path, "ab");
+    if (fp == NULL) return -1;
+    int ok = fwrite(rec, sizeof(record), 1, fp) == 1;
+    if (fclose(fp) != 0 || !ok) return -1;
+
+    size_t lo = 0, hi = d->count;
+    while (lo < hi) {
+        size_t mid = lo + (hi - lo) / 2;
+        if (compare_records(&d->records[d->order[mid]], rec) <= 0)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+    d->records[d->count] = *rec;
+    memmove(d->order + lo + 1, d->order + lo, (d->count - lo) * sizeof(uint32_t));
+    d->order[lo] = (uint32_t)d->count;
+    d->count++;
+    return 0;
+}
+
+// Объединённый упорядоченный вид базы и журнала
+typedef struct merged_view
+{
+    const record *DB;
+    const uint32_t *order;
+    size_t base_count;
+    const delta_log *delta;
+} merged_view;
+
+// Позиция в объединённом виде: i - в базе, j - в журнале
+typedef struct merged_pos
+{
+    size_t i;
+    size_t j;
+} merged_pos;
+
+size_t merged_count(const merged_view *v) {
+    return v->base_count + v->delta->count;
+}
+
+// Позиция k объединённого порядка. При равенстве запись базы идёт раньше.
+merged_pos merged_locate(const merged_view *v, size_t k) {
+    const delta_log *d = v->delta;
+    size_t lo = (k > d->count) ? k - d->count : 0;
+    size_t hi = (k < v->base_count) ? k : v->base_count;
+    while (lo < hi) {
+        size_t i = lo + (hi - lo) / 2;
+        if (compare_records(&v->DB[v->order[i]], &d->records[d->order[k - i - 1]]) <= 0)
+            lo = i + 1;
+        else
+            hi = i;
+    }
+    merged_pos pos = {lo, k - lo};
+    return pos;
+}
+
+// Запись в позиции pos; позиция сдвигается на следующую. Для записи базы
+// *base_id получает её номер в файле, для записи журнала - UINT32_MAX.
+const record *merged_next(const merged_view *v, merged_pos *pos, uint32_t *base_id) {
+    const delta_log *d = v->delta;
+    const record *base = (pos->i < v->base_count) ? &v->DB[v->order[pos->i]] : NULL;
+    const record *added = (pos->j < d->count) ? &d->records[d->order[pos->j]] : NULL;
+    if (base != NULL && (added == NULL || compare_records(base, added) <= 0)) {
+        *base_id = v->order[pos->i++];
+        return base;
+    }
+    *base_id = UINT32_MAX;
+    pos->j++;
+    return added;
+}
+
+// Уплотнение: база и журнал сливаются в новый файл базы, журнал удаляется.
+// Результат уже отсортирован, поэтому следующий запуск не сортирует его.
+int compact_database(const char *db_path, size_t memory_mb) {
+    record_db db;
+    delta_log delta;
+    if (db_open(&db, db_path) != 0) return -1;
+    if (delta_load(&delta, db_path) != 0) {
+        db_close(&db);
+        return -1;
+    }
+
+    file_map index_map;
+    const uint32_t *order = NULL;
+    uint32_t *sorted = NULL;
+    if (index_open(&index_map, db_path, &db, &order) != 0) {
+        sorted = (uint32_t *)malloc((db.count ? db.count : 1) * sizeof(uint32_t));
+        if (sorted == NULL) {
+            delta_free(&delta);
+            db_close(&db);
+            return -1;
+        }
+        for (size_t i = 0; i < db.count; i++) sorted[i] = (uint32_t)i;
+        if (!records_sorted(db.records, db.count) &&
+            parallel_sort_order(db.records, sorted, db.count, cpu_count()) != 0) {
+            sort_base = db.records;
+            qsort(sorted, db.count, sizeof(uint32_t), compare_order);
+        }
+        order = sorted;
+    }
+
+    char tmp_path[1040];
+    snprintf(tmp_path, sizeof(tmp_path), "%s.tmp", db_path);
+    FILE *out = fopen(tmp_path, "wb");
+    size_t cap = memory_mb * 1024 * 1024 / sizeof(record) / 4;
+    if (cap < 1024) cap = 1024;
+    record *buf = (record *)malloc(cap * sizeof(record));
+    int ok = out != NULL && buf != NULL;
+
+    merged_view view = {db.records, order, db.count, &delta};
+    merged_pos pos = {0, 0};
+    size_t total = merged_count(&view), filled = 0;
+    for (size_t k = 0; ok && k < total; k++) {
+        uint32_t base_id;
+        buf[filled++] = *merged_next(&view, &pos, &base_id);
+        if (filled == cap || k + 1 == total) {
+            ok = fwrite(buf, sizeof(record), filled, out) == filled;
+            filled = 0;
+        }
+    }
+    if (out != NULL && fclose(out) != 0) ok = 0;
+    free(buf);
+
+    if (sorted != NULL)
+        free(sorted);
+    else
+        unmap_file(&index_map);
+    delta_free(&delta);
+    db_close(&db);
+
+    // База больше не отображена, её можно заменить
+    if (ok) {
+        char path[1024];
+        ok = replace_file(tmp_path, db_path) == 0;
+        delta_path(db_path, path, sizeof(path));
+        if (ok) remove(path);
+        index_path(db_path, path, sizeof(path));
+        remove(path);
+    }
+    if (!ok) remove(tmp_path);
+    return ok ? 0 : -1;
+}
+
+// ---- Вывод на терминал ----
+// Консоль один раз переключается в UTF-8, поля записей (CP866) перекодируются
+// в программе. Экран собирается в один буфер и выводится одним вызовом write
+// вместе с ANSI-кодом очистки, без запуска cls и chcp.
+
+#define ANSI_CLEAR "\x1b[H\x1b[2J"
+#define RULE "-------------------------------------------------------------------------------\n"
+
+// Коды Unicode для байтов CP866 0x80..0xFF
+static const uint16_t cp866_unicode[128] = {
+    0x0410, 0x0411, 0x0412, 0x0413, 0x0414, 0x0415, 0x0416, 0x0417,
+    0x0418, 0x0419, 0x041A, 0x041B, 0x041C, 0x041D, 0x041E, 0x041F,
+    0x0420, 0x0421, 0x0422, 0x0423, 0x0424, 0x0425, 0x0426, 0x0427,
+    0x0428, 0x0429, 0x042A, 0x042B, 0x042C, 0x042D, 0x042E, 0x042F,
+    0x0430, 0x0431, 0x0432, 0x0433, 0x0434, 0x0435, 0x0436, 0x0437,
+    0x0438, 0x0439, 0x043A, 0x043B, 0x043C, 0x043D, 0x043E, 0x043F,
+    0x2591, 0x2592, 0x2593, 0x2502, 0x2524, 0x2561, 0x2562, 0x2556,
+    0x2555, 0x2563, 0x2551, 0x2557, 0x255D, 0x255C, 0x255B, 0x2510,
+    0x2514, 0x2534, 0x252C, 0x251C, 0x2500, 0x253C, 0x255E, 0x255F,
+    0x255A, 0x2554, 0x2569, 0x2566, 0x2560, 0x2550, 0x256C, 0x2567,
+    0x2568, 0x2564, 0x2565, 0x2559, 0x2558, 0x2552, 0x2553, 0x256B,
+    0x256A, 0x2518, 0x250C, 0x2588, 0x2584, 0x258C, 0x2590, 0x2580,
+    0x0440, 0x0441, 0x0442, 0x0443, 0x0444, 0x0445, 0x0446, 0x0447,
+    0x0448, 0x0449, 0x044A, 0x044B, 0x044C, 0x044D, 0x044E, 0x044F,
+    0x0401, 0x0451, 0x0404, 0x0454, 0x0407, 0x0457, 0x040E, 0x045E,
+    0x00B0, 0x2219, 0x00B7, 0x221A, 0x2116, 0x00A4, 0x25A0, 0x00A0
+};
+
+// Растущий буфер вывода. Если памяти не хватило, буфер помечается failed и
+// дальнейшие добавления пропускаются; тот, кто собирал текст, проверяет
+// failed и сам решает, как сообщить об ошибке.
+typedef struct text_buf
+{
+    char *data;
+    size_t len;
+    size_t cap;
+    int failed;
+} text_buf;
+
+static int tb_reserve(text_buf *tb, size_t extra) {
+    if (tb->failed) return -1;
+    if (tb->len + extra <= tb->cap) return 0;
+    size_t cap = tb->cap ? tb->cap : 4096;
+    while (cap < tb->len + extra) cap *= 2;
+    char *data = (char *)realloc(tb->data, cap);
+    if (data == NULL) {
+        tb->failed = 1;
+        return -1;
+    }
+    tb->data = data;
+    tb->cap = cap;
+    return 0;
+}
+
+// Пустой буфер (память остаётся для следующего текста)
+void tb_clear(text_buf *tb) {
+    tb->len = 0;
+    tb->failed = 0;
+}
+
+void tb_append(text_buf *tb, const char *data, size_t len) {
+    if (tb_reserve(tb, len) != 0) return;
+    memcpy(tb->data + tb->len, data, len);
+    tb->len += len;
+}
+
+// Добавляет содержимое другого буфера; его нехватка памяти переходит в tb
+void tb_append_buf(text_buf *tb, const text_buf *src) {
+    if (src->failed) tb->failed = 1;
+    else tb_append(tb, src->data, src->len);
+}
+
+void tb_printf(text_buf *tb, const char *fmt, ...) {
+    char small[256];
+    va_list args;
+    va_start(args, fmt);
+    int n = vsnprintf(small, sizeof(small), fmt, args);
+    va_end(args);
+    if (n < 0) return;
+    if ((size_t)n < sizeof(small)) {
+        tb_append(tb, small, (size_t)n);
+        return;
+    }
+    if (tb_reserve(tb, (size_t)n + 1) != 0) return;
+    va_start(args, fmt);
+    vsnprintf(tb->data + tb->len, (size_t)n + 1, fmt, args);
+    va_end(args);
+    tb->len += (size_t)n;
+}
+
+static void tb_spaces(text_buf *tb, size_t count) {
+    if (tb_reserve(tb, count) != 0) return;
+    memset(tb->data + tb->len, ' ', count);
+    tb->len += count;
+}
+
+// Поле CP866 (до '\0', не длиннее field_len) в UTF-8, дополненное пробелами
+// до width символов
+void tb_cp866(text_buf *tb, const char *field, size_t field_len, size_t width) {
+    if (tb_reserve(tb, field_len * 3) != 0) return;
+    char *out = tb->data + tb->len;
+    size_t chars = 0;
+    for (; chars < field_len && field[chars] != '\0'; chars++) {
+        unsigned char c = (unsigned char)field[chars];
+        if (c < 0x80) {
+            *out++ = (char)c;
+            continue;
+        }
+        unsigned u = cp866_unicode[c - 0x80];
+        if (u < 0x800) {
+            *out++ = (char)(0xC0 | (u >> 6));
+        } else {
+            *out++ = (char)(0xE0 | (u >> 12));
+            *out++ = (char)(0x80 | ((u >> 6) & 0x3F));
+        }
+        *out++ = (char)(0x80 | (u & 0x3F));
+    }
+    tb->len = (size_t)(out - tb->data);
+    if (chars < width) tb_spaces(tb, width - chars);
+}
+
+// Строка UTF-8, дополненная пробелами до width символов
+void tb_utf8(text_buf *tb, const char *text, size_t width) {
+    size_t chars = 0;
+    for (const char *c = text; *c; c++)
+        if (((unsigned char)*c & 0xC0) != 0x80) chars++;
+    tb_append(tb, text, strlen(text));
+    if (chars < width) tb_spaces(tb, width - chars);
+}
+
+// Строка записи в формате "%-30s %-6hu %-10s %-22s"
+void tb_record(text_buf *tb, const record *rec) {
+    field_view depositor = record_depositor(rec), date = record_date(rec), lawyer = record_lawyer(rec);
+    tb_cp866(tb, depositor.data, depositor.len, DEPOSITOR_LEN);
+    tb_printf(tb, " %-6u ", record_amount(rec));
+    tb_cp866(tb, date.data, date.len, DATE_LEN);
+    tb_append(tb, " ", 1);
+    tb_cp866(tb, lawyer.data, lawyer.len, LAWYER_LEN);
+    tb_append(tb, "\n", 1);
+}
+
+// Заголовок таблицы записей
+void tb_header(text_buf *tb) {
+    tb_utf8(tb, "ФИО вкладчика", 31);
+    tb_utf8(tb, "Сумма", 7);
+    tb_utf8(tb, "Дата", 11);
+    tb_utf8(tb, "Адвокат", 0);
+    tb_append(tb, "\n" RULE, 1 + strlen(RULE));
+}
+
+// Выводит буфер одним системным вызовом и очищает его
+void tb_flush(text_buf *tb) {
+    if (tb->failed) tb->len = 0;  // Недособранный экран не выводится
+    fflush(stdout);
+    size_t done = 0;
+    while (done < tb->len) {
+#ifdef _WIN32
+        DWORD written = 0;
+        if (!WriteFile(GetStdHandle(STD_OUTPUT_HANDLE), tb->data + done,
+                       (DWORD)(tb->len - done), &written, NULL) || written == 0)
+            break;
+#else
+        ssize_t written = write(STDOUT_FILENO, tb->data + done, tb->len - done);
+        if (written <= 0) break;
+#endif
+        done += (size_t)written;
+    }
+    if (tb->failed) printf("\nНедостаточно памяти для вывода!\n");
+    tb_clear(tb);
+}
+
+void tb_free(text_buf *tb) {
+    free(tb->data);
+    memset(tb, 0, sizeof(*tb));
+}
+
+// Переключает консоль Windows в UTF-8 и включает обработку ANSI-кодов.
+// На других системах терминал уже работает в UTF-8.
+void terminal_init(void) {
+#ifdef _WIN32
+#ifndef ENABLE_VIRTUAL_TERMINAL_PROCESSING
+#define ENABLE_VIRTUAL_TERMINAL_PROCESSING 0x0004
+#endif
+    SetConsoleOutputCP(CP_UTF8);
+    SetConsoleCP(CP_UTF8);
+    HANDLE out = GetStdHandle(STD_OUTPUT_HANDLE);
+    DWORD mode;
+    if (GetConsoleMode(out, &mode))
+        SetConsoleMode(out, mode | ENABLE_VIRTUAL_TERMINAL_PROCESSING);
+#endif
+}
+
+// Перекодирует введённую строку из UTF-8 в CP866 на месте, чтобы сравнивать
+// её с полями базы. Байты, не образующие корректный UTF-8, остаются как есть
+// (так продолжает работать ввод уже в CP866).
+void utf8_to_cp866(char *text) {
+    unsigned char *in = (unsigned char *)text, *out = (unsigned char *)text;
+    while (*in) {
+        unsigned u = 0;
+        size_t n = 0;
+        if (in[0] >= 0xC0 && in[0] < 0xE0 && (in[1] & 0xC0) == 0x80) {
+            u = ((in[0] & 0x1Fu) << 6) | (in[1] & 0x3Fu);
+            n = 2;
+        } else if (in[0] >= 0xE0 && in[0] < 0xF0 && (in[1] & 0xC0) == 0x80 && (in[2] & 0xC0) == 0x80) {
+            u = ((in[0] & 0x0Fu) << 12) | ((in[1] & 0x3Fu) << 6) | (in[2] & 0x3Fu);
+            n = 3;
+        }
+        int code = -1;
+        for (int c = 0; n > 0 && c < 128; c++)
+            if (cp866_unicode[c] == u) code = 0x80 + c;
+        if (code < 0) {
+            *out++ = *in++;
+        } else {
+            *out++ = (unsigned char)code;
+            in += n;
+        }
+    }
+    *out = '\0';
+}
+
+// Считывает строку ввода без перевода строки. Возвращает -1 в конце ввода.
+int read_line(char *buf, size_t size) {
+    if (fgets(buf, (int)size, stdin) == NULL) return -1;
+    buf[strcspn(buf, "\r\n")] = '\0';
+    return 0;
+}
+
+// Считывает строку и перекодирует её в CP866 для поиска по базе
+int read_cp866_line(char *buf, size_t size) {
+    if (read_line(buf, size) != 0) return -1;
+    utf8_to_cp866(buf);
+    return 0;
+}
+
+// Считывает команду - первый символ строки, остаток строки отбрасывается.
+// В конце ввода возвращает 'q'.
+int read_command(void) {
+    int command = getchar();
+    if (command == EOF) return 'q';
+    int c = command;
+    while (c != '\n' && c != EOF) c = getchar();
+    return command;
+}
+
+// Диапазон записей объединённого вида (база и журнал), у которых ФИО
+// адвоката начинается с prefix: два бинарных поиска без чтения записей
+record_range merged_lawyer_range(const merged_view *view, const char *prefix) {
+    // Границы в объединённом порядке - суммы границ в базе и в журнале
+    const delta_log *d = view->delta;
+    record_range base = find_lawyer_prefix(view->DB, view->order, view->base_count, prefix);
+    record_range added = find_lawyer_prefix(d->records, d->order, d->count, prefix);
+    record_range range = {base.begin + added.begin, base.end + added.end};
+    return range;
+}
+
+// Записи найденного диапазона объединённого вида в буфер
+record_range tb_search_lawyer(text_buf *tb, const merged_view *view, const char *search_prefix) {
+    size_t prefix_len = strlen(search_prefix);
+    tb_printf(tb, "\nРезультаты поиска по адвокату \"");
+    tb_cp866(tb, search_prefix, prefix_len, 0);
+    tb_printf(tb, "\":\n" RULE);
+
+    record_range range = merged_lawyer_range(view, search_prefix);
+    merged_pos pos = merged_locate(view, range.begin);
+    for (size_t i = range.begin; i < range.end; i++) {
+        uint32_t base_id;
+        tb_record(tb, merged_next(view, &pos, &base_id));
+    }
+    
+    if (range.begin == range.end) {
+        tb_printf(tb, "Адвокатов с фамилией, начинающейся на \"");
+        tb_cp866(tb, search_prefix, prefix_len, 0);
+        tb_printf(tb, "\", не найдено.\n");
+    } else {
+        tb_printf(tb, "\nНайдено записей: %zu\n", range.end - range.begin);
+    }
+    return range;
+}
+
+// ---- Вторичные индексы и запросы по нескольким полям ----
+
+#define NO_DATE INT32_MIN   // Дата не разобрана или граница не задана
+
+// Номер дня для даты "ДД-ММ-ГГ" (годы 50-99 - это 1950-1999, 00-49 - 2000-2049).
+// Такие номера можно сравнивать как числа. Возвращает NO_DATE для неверной даты.
+int32_t parse_date(const char *date) {
+    for (int i = 0; i < 8; i++) {
+        if (i == 2 || i == 5) {
+            if (date[i] != '-') return NO_DATE;
+        } else if (date[i] < '0' || date[i] > '9') {
+            return NO_DATE;
+        }
+    }
+    int day = (date[0] - '0') * 10 + (date[1] - '0');
+    int month = (date[3] - '0') * 10 + (date[4] - '0');
+    int year = (date[6] - '0') * 10 + (date[7] - '0');
+    year += (year >= 50) ? 1900 : 2000;
+    if (month < 1 || month > 12 || day < 1 || day > 31) return NO_DATE;
+
+    // Число дней от 01.03.0000 по григорианскому календарю
+    if (month <= 2) {
+        year--;
+        month += 12;
+    }
+    return 365 * year + year / 4 - year / 100 + year / 400 + (153 * (month - 3) + 2) / 5 + day - 1;
+}
+
+// Вторичные индексы: перестановки, отсортированные по другим полям.
+// Строятся при первом запросе, который их использует.
+typedef struct secondary_indexes
+{
+    const record *DB;
+    size_t count;
+    int32_t *days;          // Номер дня каждой записи (по номеру записи)
+    uint32_t *by_depositor; // По ФИО вкладчика
+    uint32_t *by_date;      // По дате
+    uint32_t *by_amount;    // По сумме вклада
+} secondary_indexes;
+
+void secondary_init(secondary_indexes *idx, const record *DB, size_t total_records) {
+    memset(idx, 0, sizeof(*idx));
+    idx->DB = DB;
+    idx->count = total_records;
+}
+
+void secondary_free(secondary_indexes *idx) {
+    free(idx->days);
+    free(idx->by_depositor);
+    free(idx->by_date);
+    free(idx->by_amount);
+    memset(idx, 0, sizeof(*idx));
+}
+
+static int compare_depositor_order(const void *a, const void *b) {
+    uint32_t ia = *(const uint32_t *)a, ib = *(const uint32_t *)b;
+    int cmp = strncmp(sort_base[ia].depositor, sort_base[ib].depositor, sizeof(sort_base->depositor));
+    if (cmp != 0) return cmp;
+    return (ia > ib) - (ia < ib);
+}
+
+// Устойчивая сортировка подсчётом номеров записей по ключу keys[i] из [0, range)
+static uint32_t *counting_sort_order(const uint32_t *keys, size_t total_records, size_t range) {
+    uint32_t *order = (uint32_t *)malloc((total_records ? total_records : 1) * sizeof(uint32_t));
+    size_t *pos = (size_t *)calloc(range + 1, sizeof(size_t));
+    if (order == NULL || pos == NULL) {
+        free(order);
+        free(pos);
+        return NULL;
+    }
+    for (size_t i = 0; i < total_records; i++) pos[keys[i] + 1]++;
+    for (size_t k = 0; k < range; k++) pos[k + 1] += pos[k];
+    for (size_t i = 0; i < total_records; i++) order[pos[keys[i]]++] = (uint32_t)i;
+    free(pos);
+    return order;
+}
+
+static int ensure_days(secondary_indexes *idx) {
+    if (idx->days != NULL) return 0;
+    idx->days = (int32_t *)malloc((idx->count ? idx->count : 1) * sizeof(int32_t));
+    if (idx->days == NULL) return -1;
+    for (size_t i = 0; i < idx->count; i++) idx->days[i] = parse_date(idx->DB[i].date);
+    return 0;
+}
+
+static int ensure_by_depositor(secondary_indexes *idx) {
+    if (idx->by_depositor != NULL) return 0;
+    idx->by_depositor = (uint32_t *)malloc((idx->count ? idx->count : 1) * sizeof(uint32_t));
+    if (idx->by_depositor == NULL) return -1;
+    for (size_t i = 0; i < idx->count; i++) idx->by_depositor[i] = (uint32_t)i;
+    sort_base = idx->DB;
+    qsort(idx->by_depositor, idx->count, sizeof(uint32_t), compare_depositor_order);
+    return 0;
+}
+
+static int ensure_by_amount(secondary_indexes *idx) {
+    if (idx->by_amount != NULL) return 0;
+    uint32_t *keys = (uint32_t *)malloc((idx->count ? idx->count : 1) * sizeof(uint32_t));
+    if (keys == NULL) return -1;
+    for (size_t i = 0; i < idx->count; i++) keys[i] = idx->DB[i].amount;
+    idx->by_amount = counting_sort_order(keys, idx->count, 65536);
+    free(keys);
+    return idx->by_amount != NULL ? 0 : -1;
+}
+
+// Даты сортируются подсчётом по смещению от самой ранней; неверные даты
+// (NO_DATE) идут первыми
+static int ensure_by_date(secondary_indexes *idx) {
+    if (idx->by_date != NULL) return 0;
+    if (ensure_days(idx) != 0) return -1;
+
+    int32_t min_day = INT32_MAX, max_day = INT32_MIN;
+    for (size_t i = 0; i < idx->count; i++) {
+        if (idx->days[i] == NO_DATE) continue;
+        if (idx->days[i] < min_day) min_day = idx->days[i];
+        if (idx->days[i] > max_day) max_day = idx->days[i];
+    }
+    size_t range = (min_day <= max_day) ? (size_t)(max_day - min_day) + 2 : 1;
+
+    uint32_t *keys = (uint32_t *)malloc((idx->count ? idx->count : 1) * sizeof(uint32_t));
+    if (keys == NULL) return -1;
+    for (size_t i = 0; i < idx->count; i++)
+        keys[i] = (idx->days[i] == NO_DATE) ? 0 : (uint32_t)(idx->days[i] - min_day) + 1;
+    idx->by_date = counting_sort_order(keys, idx->count, range);
+    free(keys);
+    return idx->by_date != NULL ? 0 : -1;
+}
+
+// Первая позиция в order, где значение (день или сумма) >= value
+static size_t value_lower_bound(const secondary_indexes *idx, const uint32_t *order,
+                                int by_date, int64_t value) {
+    size_t lo = 0, hi = idx->count;
+    while (lo < hi) {
+        size_t mid = lo + (hi - lo) / 2;
+        int64_t v = by_date ? idx->days[order[mid]] : idx->DB[order[mid]].amount;
+        if (v < value)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+    return lo;
+}
+
+// Запрос: пустая строка или отсутствующая граница означают "без условия"
+typedef struct record_query
+{
+    char lawyer_prefix[23];
+    char depositor_prefix[31];
+    int32_t date_from;      // Включительно, NO_DATE - без нижней границы
+    int32_t date_to;        // Включительно, NO_DATE - без верхней границы
+    long amount_min;        // Включительно, -1 - без границы
+    long amount_max;        // Включительно, -1 - без границы
+} record_query;
+
+void query_init(record_query *q) {
+    memset(q, 0, sizeof(*q));
+    q->date_from = NO_DATE;
+    q->date_to = NO_DATE;
+    q->amount_min = -1;
+    q->amount_max = -1;
+}
+
+// Проверка остальных условий запроса для одной записи
+static int query_matches(const secondary_indexes *idx, const record_query *q, uint32_t i) {
+    const record *rec = &idx->DB[i];
+    if (q->lawyer_prefix[0] &&
+        strncmp(rec->lawyer, q->lawyer_prefix, strlen(q->lawyer_prefix)) != 0)
+        return 0;
+    if (q->depositor_prefix[0] &&
+        strncmp(rec->depositor, q->depositor_prefix, strlen(q->depositor_prefix)) != 0)
+        return 0;
+    if (q->amount_min >= 0 && rec->amount < q->amount_min) return 0;
+    if (q->amount_max >= 0 && rec->amount > q->amount_max) return 0;
+    if (q->date_from != NO_DATE || q->date_to != NO_DATE) {
+        int32_t day = idx->days[i];
+        if (day == NO_DATE) return 0;
+        if (q->date_from != NO_DATE && day < q->date_from) return 0;
+        if (q->date_to != NO_DATE && day > q->date_to) return 0;
+    }
+    return 1;
+}
+
+// Выполняет запрос. Для каждого условия бинарным поиском находится диапазон
+// в своём индексе; размер диапазона - точная селективность условия. Перебирается
+// самый короткий диапазон, а остальные условия проверяются по самим записям,
+// то есть результат - пересечение всех диапазонов. Номера найденных записей
+// (в порядке выбранного индекса) возвращаются в *result (освобождает вызывающий).
+// Возвращает число найденных записей или -1 при нехватке памяти.
+long query_run(secondary_indexes *idx, const uint32_t *order, const record_query *q, uint32_t **result) {
+    const uint32_t *best = order;
+    record_range best_range = {0, idx->count};
+    *result = NULL;
+
+    if (q->date_from != NO_DATE || q->date_to != NO_DATE) {
+        if (ensure_by_date(idx) != 0) return -1;
+        // Верхняя граница считается по следующему дню, поэтому неверные даты
+        // (NO_DATE) всегда остаются слева от диапазона
+        record_range r;
+        r.begin = value_lower_bound(idx, idx->by_date, 1,
+                                    q->date_from != NO_DATE ? q->date_from : (int64_t)NO_DATE + 1);
+        r.end = (q->date_to != NO_DATE) ? value_lower_bound(idx, idx->by_date, 1, (int64_t)q->date_to + 1)
+                                        : idx->count;
+        if (r.end < r.begin) r.end = r.begin;
+        if (r.end - r.begin < best_range.end - best_range.begin) {
+            best = idx->by_date;
+            best_range = r;
+        }
+    }
+    if (q->amount_min >= 0 || q->amount_max >= 0) {
+        if (ensure_by_amount(idx) != 0) return -1;
+        record_range r;
+        r.begin = value_lower_bound(idx, idx->by_amount, 0, q->amount_min >= 0 ? q->amount_min : 0);
+        r.end = (q->amount_max >= 0) ? value_lower_bound(idx, idx->by_amount, 0, q->amount_max + 1)
+                                     : idx->count;
+        if (r.end < r.begin) r.end = r.begin;
+        if (r.end - r.begin < best_range.end - best_range.begin) {
+            best = idx->by_amount;
+            best_range = r;
+        }
+    }
+    if (q->depositor_prefix[0]) {
+        if (ensure_by_depositor(idx) != 0) return -1;
+        record_range r = find_field_prefix(idx->DB, idx->by_depositor, idx->count,
+                                           offsetof(record, depositor), sizeof(idx->DB->depositor),
+                                           q->depositor_prefix);
+        if (r.end - r.begin < best_range.end - best_range.begin) {
+            best = idx->by_depositor;
+            best_range = r;
+        }
+    }
+    if (q->lawyer_prefix[0]) {
+        record_range r = find_lawyer_prefix(idx->DB, order, idx->count, q->lawyer_prefix);
+        if (r.end - r.begin < best_range.end - best_range.begin) {
+            best = order;
+            best_range = r;
+        }
+    }
+    if ((q->date_from != NO_DATE || q->date_to != NO_DATE) && ensure_days(idx) != 0) return -1;
+
+    size_t candidates = best_range.end - best_range.begin;
+    *result = (uint32_t *)malloc((candidates ? candidates : 1) * sizeof(uint32_t));
+    if (*result == NULL) return -1;
+
+    long found = 0;
+    for (size_t i = best_range.begin; i < best_range.end; i++)
+        if (query_matches(idx, q, best[i])) (*result)[found++] = best[i];
+    return found;
+}
+
+// Наибольшие или наименьшие k записей по сумме или дате среди отвечающих
+// запросу. Ключ записи - значение поля в старших 32 битах и номер записи в
+// младших, так что равные значения упорядочены по номеру, как в индексе.
+static uint64_t top_key(const secondary_indexes *idx, int by_date, uint32_t i) {
+    uint32_t value = by_date ? (uint32_t)((int64_t)idx->days[i] - INT32_MIN) : idx->DB[i].amount;
+    return (uint64_t)value << 32 | i;
+}
+
+// Куча из k отобранных ключей; в корне худший из них (наименьший, если
+// ищутся наибольшие)
+static int top_worse(uint64_t a, uint64_t b, int largest) {
+    return largest ? a < b : a > b;
+}
+
+static void top_sift_down(uint64_t *heap, size_t size, size_t i, int largest) {
+    for (;;) {
+        size_t worst = i, left = 2 * i + 1, right = left + 1;
+        if (left < size && top_worse(heap[left], heap[worst], largest)) worst = left;
+        if (right < size && top_worse(heap[right], heap[worst], largest)) worst = right;
+        if (worst == i) return;
+        uint64_t tmp = heap[i];
+        heap[i] = heap[worst];
+        heap[worst] = tmp;
+        i = worst;
+    }
+}
+
+static int compare_keys_asc(const void *a, const void *b) {
+    uint64_t x = *(const uint64_t *)a, y = *(const uint64_t *)b;
+    return (x > y) - (x < y);
+}
+
+static int compare_keys_desc(const void *a, const void *b) {
+    return compare_keys_asc(b, a);
+}
+
+// Если запрос ограничивает только поле упорядочения, ответ - k крайних
+// записей диапазона в индексе этого поля (бинарный поиск и k шагов).
+// Иначе кандидаты отбираются query_run, а k лучших из них - кучей размера k
+// за один проход без полной сортировки. Номера записей возвращаются в
+// *result от лучшей к худшей. Возвращает их число или -1 при нехватке памяти.
+long query_top(secondary_indexes *idx, const uint32_t *order, const record_query *q,
+               int by_date, int largest, size_t k, uint32_t **result) {
+    *result = NULL;
+    if (ensure_days(idx) != 0) return -1;
+    if (k > idx->count) k = idx->count;
+
+    int date_limited = q->date_from != NO_DATE || q->date_to != NO_DATE;
+    int amount_limited = q->amount_min >= 0 || q->amount_max >= 0;
+    if (!q->lawyer_prefix[0] && !q->depositor_prefix[0] && !(by_date ? amount_limited : date_limited)) {
+        if ((by_date ? ensure_by_date(idx) : ensure_by_amount(idx)) != 0) return -1;
+        const uint32_t *index = by_date ? idx->by_date : idx->by_amount;
+        int64_t low = by_date ? (q->date_from != NO_DATE ? q->date_from : (int64_t)NO_DATE + 1)
+                              : (q->amount_min >= 0 ? q->amount_min : 0);
+        size_t begin = value_lower_bound(idx, index, by_date, low);
+        size_t end = idx->count;
+        if (by_date && q->date_to != NO_DATE) end = value_lower_bound(idx, index, 1, (int64_t)q->date_to + 1);
+        if (!by_date && q->amount_max >= 0) end = value_lower_bound(idx, index, 0, q->amount_max + 1);
+        if (end < begin) end = begin;
+        if (end - begin < k) k = end - begin;
+
+        *result = (uint32_t *)malloc((k ? k : 1) * sizeof(uint32_t));
+        if (*result == NULL) return -1;
+        for (size_t j = 0; j < k; j++) (*result)[j] = index[largest ? end - 1 - j : begin + j];
+        return (long)k;
+    }
+
+    uint32_t *candidates;
+    long count = query_run(idx, order, q, &candidates);
+    if (count < 0) return -1;
+    uint64_t *heap = (uint64_t *)malloc((k ? k : 1) * sizeof(uint64_t));
+    if (heap == NULL) {
+        free(candidates);
+        return -1;
+    }
+    size_t size = 0;
+    for (long c = 0; c < count && k > 0; c++) {
+        if (by_date && idx->days[candidates[c]] == NO_DATE) continue;
+        uint64_t key = top_key(idx, by_date, candidates[c]);
+        if (size < k) {
+            // Просеивание вверх
+            size_t i = size++;
+            heap[i] = key;
+            while (i > 0 && top_worse(heap[i], heap[(i - 1) / 2], largest)) {
+                uint64_t tmp = heap[i];
+                heap[i] = heap[(i - 1) / 2];
+                heap[(i - 1) / 2] = tmp;
+                i = (i - 1) / 2;
+            }
+        } else if (top_worse(heap[0], key, largest)) {
+            heap[0] = key;
+            top_sift_down(heap, size, 0, largest);
+        }
+    }
+    qsort(heap, size, sizeof(uint64_t), largest ? compare_keys_desc : compare_keys_asc);
+    for (size_t j = 0; j < size; j++) candidates[j] = (uint32_t)heap[j];
+    free(heap);
+    *result = candidates;
+    return (long)size;
+}
+
+// ---- Колоночное представление (структура массивов) ----
+// Каждое поле хранится отдельным непрерывным массивом, поэтому просмотр одной
+// суммы или даты не тянет через кэш ФИО. Циклы по колонкам написаны без
+// ветвлений, чтобы компилятор мог их векторизовать. Поле даты, которое не
+// восстанавливается по номеру дня побайтно (неверная или записанная не в
+// формате fill_field дата), хранится отдельно как есть.
+typedef struct record_columns
+{
+    size_t count;
+    uint16_t *amount;
+    int32_t *day;                   // Номер дня (parse_date), NO_DATE - неверная дата
+    char (*depositor)[DEPOSITOR_LEN];
+    char (*lawyer)[LAWYER_LEN];
+    size_t raw_count;               // Даты, хранящиеся как в файле
+    size_t raw_cap;
+    uint32_t *raw_ids;              // По возрастанию
+    char (*raw_dates)[DATE_LEN];
+} record_columns;
+
+// Заполняет строковое поле записи как в файле базы: текст в CP866,
+// пробелы до конца поля и '\0' в последнем байте
+static void fill_field(char *field, size_t field_len, const char *text) {
+    size_t len = strlen(text);
+    if (len > field_len - 1) len = field_len - 1;
+    memcpy(field, text, len);
+    memset(field + len, ' ', field_len - 1 - len);
+    field[field_len - 1] = '\0';
+}
+
+
+// Дата "ДД-ММ-ГГ" по номеру дня (обратно к parse_date)
+void day_to_date(int32_t day, char *out) {
+    if (day == NO_DATE) {
+        memcpy(out, "00-00-00", 9);
+        return;
+    }
+    int32_t doe, yoe, doy, mp, year;
+    int32_t era = day / 146097;
+    doe = day - era * 146097;
+    yoe = (doe - doe / 1460 + doe / 36524 - doe / 146096) / 365;
+    year = yoe + era * 400;
+    doy = doe - (365 * yoe + yoe / 4 - yoe / 100);
+    mp = (5 * doy + 2) / 153;
+    int d = doy - (153 * mp + 2) / 5 + 1;
+    int m = mp < 10 ? mp + 3 : mp - 9;
+    if (m <= 2) year++;
+    snprintf(out, 10, "%02u-%02u-%02u", (unsigned)d % 100, (unsigned)m % 100, (unsigned)year % 100);
+}
+
+void columns_free(record_columns *cols) {
+    free(cols->amount);
+    free(cols->day);
+    free(cols->depositor);
+    free(cols->lawyer);
+    free(cols->raw_ids);
+    free(cols->raw_dates);
+    memset(cols, 0, sizeof(*cols));
+}
+
+// Поле даты, как columns_row восстановит его по номеру дня
+static void day_to_field(int32_t day, char *field) {
+    char text[DATE_LEN];
+    day_to_date(day, text);
+    fill_field(field, DATE_LEN, text);
+}
+
+static int columns_keep_date(record_columns *cols, size_t i, const char *date) {
+    if (cols->raw_count == cols->raw_cap) {
+        size_t cap = cols->raw_cap ? cols->raw_cap * 2 : 64;
+        uint32_t *ids = (uint32_t *)realloc(cols->raw_ids, cap * sizeof(uint32_t));
+        if (ids == NULL) return -1;
+        cols->raw_ids = ids;
+        char (*dates)[DATE_LEN] = realloc(cols->raw_dates, cap * sizeof(*dates));
+        if (dates == NULL) return -1;
+        cols->raw_dates = dates;
+        cols->raw_cap = cap;
+    }
+    cols->raw_ids[cols->raw_count] = (uint32_t)i;
+    memcpy(cols->raw_dates[cols->raw_count], date, DATE_LEN);
+    cols->raw_count++;
+    return 0;
+}
+
+// Строит колонки по базе за один проход. Возвращает 0 при успехе.
+int columns_build(record_columns *cols, const record *DB, size_t total_records) {
+    size_t n = total_records ? total_records : 1;
+    memset(cols, 0, sizeof(*cols));
+    cols->count = total_records;
+    cols->amount = (uint16_t *)malloc(n * sizeof(uint16_t));
+    cols->day = (int32_t *)malloc(n * sizeof(int32_t));
+    cols->depositor = malloc(n * sizeof(*cols->depositor));
+    cols->lawyer = malloc(n * sizeof(*cols->lawyer));
+    if (cols->amount == NULL || cols->day == NULL || cols->depositor == NULL || cols->lawyer == NULL) {
+        columns_free(cols);
+        return -1;
+    }
+    for (size_t i = 0; i < total_records; i++) {
+        cols->amount[i] = DB[i].amount;
+        cols->day[i] = parse_date(DB[i].date);
+        memcpy(cols->depositor[i], DB[i].depositor, sizeof(DB[i].depositor));
+        memcpy(cols->lawyer[i], DB[i].lawyer, sizeof(DB[i].lawyer));
+        char date[DATE_LEN];
+        day_to_field(cols->day[i], date);
+        if (memcmp(date, DB[i].date, DATE_LEN) != 0 && columns_keep_date(cols, i, DB[i].date) != 0) {
+            columns_free(cols);
+            return -1;
+        }
+    }
+    return 0;
+}
+
+// Восстановление строки записи для вывода
+void columns_row(const record_columns *cols, size_t i, record *out) {
+    memcpy(out->depositor, cols->depositor[i], sizeof(out->depositor));
+    out->amount = cols->amount[i];
+    day_to_field(cols->day[i], out->date);
+    size_t lo = 0, hi = cols->raw_count;
+    while (lo < hi) {
+        size_t mid = lo + (hi - lo) / 2;
+        if (cols->raw_ids[mid] < i) lo = mid + 1;
+        else hi = mid;
+    }
+    if (lo < cols->raw_count && cols->raw_ids[lo] == i) memcpy(out->date, cols->raw_dates[lo], DATE_LEN);
+    memcpy(out->lawyer, cols->lawyer[i], sizeof(out->lawyer));
+}
+
+// Сводка по колонкам: сумма, минимум и максимум вклада, диапазон дат
+typedef struct columns_summary
+{
+    uint64_t total;
+    unsigned min_amount;
+    unsigned max_amount;
+    int32_t first_day;
+    int32_t last_day;
+} columns_summary;
+
+void columns_summarize(const record_columns *cols, columns_summary *out) {
+    uint64_t total = 0;
+    unsigned min_amount = 0xFFFF, max_amount = 0;
+    for (size_t i = 0; i < cols->count; i++) {
+        unsigned a = cols->amount[i];
+        total += a;
+        min_amount = a < min_amount ? a : min_amount;
+        max_amount = a > max_amount ? a : max_amount;
+    }
+    // NO_DATE меньше любой даты, поэтому для минимума оно заменяется на INT32_MAX
+    int32_t first_day = INT32_MAX, last_day = NO_DATE;
+    for (size_t i = 0; i < cols->count; i++) {
+        int32_t d = cols->day[i];
+        int32_t d_min = (d == NO_DATE) ? INT32_MAX : d;
+        first_day = d_min < first_day ? d_min : first_day;
+        last_day = d > last_day ? d : last_day;
+    }
+    out->total = total;
+    out->min_amount = cols->count ? min_amount : 0;
+    out->max_amount = max_amount;
+    out->first_day = (first_day == INT32_MAX) ? NO_DATE : first_day;
+    out->last_day = last_day;
+}
+
+// Фильтр по сумме и дате полным просмотром колонок (условия по ФИО
+// не учитываются). Номера подходящих записей пишутся в out без ветвлений.
+// Возвращает их количество.
+size_t columns_filter(const record_columns *cols, const record_query *q, uint32_t *out) {
+    unsigned amount_min = q->amount_min >= 0 ? (unsigned)q->amount_min : 0;
+    unsigned amount_max = q->amount_max >= 0 ? (unsigned)q->amount_max : 0xFFFF;
+    int32_t from = q->date_from != NO_DATE ? q->date_from : NO_DATE + 1;
+    int32_t to = q->date_to != NO_DATE ? q->date_to : INT32_MAX;
+    int any_date = (q->date_from != NO_DATE || q->date_to != NO_DATE);
+    if (!any_date) from = NO_DATE;  // без условия по дате подходят и неверные даты
+
+    size_t found = 0;
+    for (size_t i = 0; i < cols->count; i++) {
+        unsigned a = cols->amount[i];
+        int32_t d = cols->day[i];
+        out[found] = (uint32_t)i;
+        found += (a >= amount_min) & (a <= amount_max) & (d >= from) & (d <= to);
+    }
+    return found;
+}
+
+// ---- Сжатое хранение со словарями (.cdb) ----
+// Запись занимает 20 байт вместо 64. ФИО адвоката и слова ФИО вкладчика
+// (фамилия, имя и остаток - отчество) заменены номерами в словарях, дата -
+// номером дня от 01-01-50 в 16 битах, сумма хранится как есть. Словари
+// упорядочены, поэтому сравнение кодов совпадает со сравнением строк:
+// сортировка по (адвокат, сумма) - это radix_sort_keys по (код << 16 | сумма)
+// без обращения к строкам, а поиск по префиксу ФИО адвоката - бинарный поиск
+// диапазона кодов в словаре и затем записей с этими кодами. Сжатие без потерь
+// для записей в формате fill_field; остальные файлы не кодируются.
+// saod -E база файл.cdb пишет сжатую копию, saod -D файл.cdb база - обратно.
+
+#define COMPACT_MAGIC "SAODCDB1"
+#define WORD_LEN DEPOSITOR_LEN      // Слово ФИО вкладчика, дополненное '\0'
+#define COMPACT_WORDS 3
+#define COMPACT_NO_DATE 0xFFFF
+
+typedef struct compact_row
+{
+    uint32_t lawyer;                // Код ФИО адвоката
+    uint32_t word[COMPACT_WORDS];   // Коды фамилии, имени и остатка ФИО вкладчика
+    uint16_t amount;
+    uint16_t day;                   // Дней от 01-01-50, COMPACT_NO_DATE - неверная дата
+} compact_row;
+
+// Файл: заголовок, словарь адвокатов, словарь слов, выравнивание до 8 байт
+// и записи
+typedef struct compact_header
+{
+    char magic[8];          // COMPACT_MAGIC
+    uint64_t record_count;
+    uint64_t lawyer_count;
+    uint64_t word_count;
+} compact_header;
+
+typedef struct compact_store
+{
+    size_t count;
+    uint32_t lawyer_count;
+    uint32_t word_count;
+    const unsigned char (*lawyers)[LAWYER_LEN];  // По возрастанию (normalize_lawyer)
+    const unsigned char (*words)[WORD_LEN];      // По возрастанию
+    const compact_row *rows;
+    unsigned char *owned;   // Память построенного хранилища (NULL, если отображено)
+    file_map map;
+} compact_store;
+
+static size_t compact_rows_offset(uint64_t lawyer_count, uint64_t word_count) {
+    size_t size = sizeof(compact_header) + (size_t)lawyer_count * LAWYER_LEN + (size_t)word_count * WORD_LEN;
+    return (size + 7) & ~(size_t)7;
+}
+
+static int32_t compact_epoch(void) {
+    return parse_date("01-01-50");
+}
+
+// Делит ФИО вкладчика на фамилию, имя и остаток по первым двум пробелам.
+// Склеивание частей через пробел восстанавливает текст поля.
+static void split_depositor(const record *rec, unsigned char parts[COMPACT_WORDS][WORD_LEN]) {
+    field_view v = record_depositor(rec);
+    memset(parts, 0, COMPACT_WORDS * WORD_LEN);
+    size_t part = 0, len = 0;
+    for (size_t i = 0; i < v.len; i++) {
+        if (v.data[i] == ' ' && part < COMPACT_WORDS - 1) {
+            part++;
+            len = 0;
+        } else {
+            parts[part][len++] = (unsigned char)v.data[i];
+        }
+    }
+}
+
+// Восстанавливает запись i
+void compact_decode(const compact_store *store, size_t i, record *out) {
+    const compact_row *row = &store->rows[i];
+    const char *w0 = (const char *)store->words[row->word[0]];
+    const char *w1 = (const char *)store->words[row->word[1]];
+    const char *w2 = (const char *)store->words[row->word[2]];
+    char text[DEPOSITOR_LEN + COMPACT_WORDS];
+    snprintf(text, sizeof(text), "%.*s %.*s %.*s", (int)strnlen(w0, WORD_LEN), w0, (int)strnlen(w1, WORD_LEN), w1,
+             (int)strnlen(w2, WORD_LEN), w2);
+    fill_field(out->depositor, DEPOSITOR_LEN, text);
+    out->amount = row->amount;
+    if (row->day == COMPACT_NO_DATE) {
+        memset(out->date, 0, DATE_LEN);
+    } else {
+        day_to_date(compact_epoch() + row->day, text);
+        fill_field(out->date, DATE_LEN, text);
+    }
+    memcpy(out->lawyer, store->lawyers[row->lawyer], LAWYER_LEN);
+}
+
+void compact_free(compact_store *store) {
+    if (store->owned != NULL) free(store->owned);
+    else unmap_file(&store->map);
+    memset(store, 0, sizeof(*store));
+}
+
+// Кодирует базу: словари собираются в хеш-таблицы, затем упорядочиваются,
+// а коды записей заменяются рангами. Возвращает 0 при успехе, -1 при нехватке
+// памяти и -2, если какая-то запись не восстанавливается без потерь.
+int compact_build(const record *DB, size_t total_records, compact_store *store) {
+    memset(store, 0, sizeof(*store));
+    name_dict lawyers, words;
+    int lawyers_ok = name_dict_init(&lawyers, LAWYER_LEN);
+    int words_ok = name_dict_init(&words, WORD_LEN);
+    compact_row *rows = (compact_row *)malloc((total_records ? total_records : 1) * sizeof(compact_row));
+    uint32_t *work = NULL;
+    int result = -1;
+    if (lawyers_ok != 0 || words_ok != 0 || rows == NULL) goto done;
+
+    int32_t epoch = compact_epoch();
+    for (size_t i = 0; i < total_records; i++) {
+        unsigned char name[LAWYER_LEN], parts[COMPACT_WORDS][WORD_LEN];
+        normalize_lawyer(DB[i].lawyer, name);
+        rows[i].lawyer = name_dict_insert(&lawyers, name);
+        if (rows[i].lawyer == UINT32_MAX) goto done;
+        split_depositor(&DB[i], parts);
+        for (int w = 0; w < COMPACT_WORDS; w++) {
+            rows[i].word[w] = name_dict_insert(&words, parts[w]);
+            if (rows[i].word[w] == UINT32_MAX) goto done;
+        }
+        rows[i].amount = DB[i].amount;
+        int32_t day = parse_date(DB[i].date);
+        rows[i].day = (day == NO_DATE || day < epoch || day - epoch >= COMPACT_NO_DATE)
+                      ? COMPACT_NO_DATE : (uint16_t)(day - epoch);
+    }
+
+    // Упорядоченные словари и ранги вместо номеров появления
+    uint32_t max_count = lawyers.count > words.count ? lawyers.count : words.count;
+    work = (uint32_t *)malloc(((size_t)max_count * 2 + 1) * sizeof(uint32_t));
+    size_t offset = compact_rows_offset(lawyers.count, words.count);
+    store->owned = (unsigned char *)malloc(offset + total_records * sizeof(compact_row));
+    if (work == NULL || store->owned == NULL) goto done;
+
+    compact_header *header = (compact_header *)store->owned;
+    memset(store->owned, 0, offset);
+    memcpy(header->magic, COMPACT_MAGIC, sizeof(header->magic));
+    header->record_count = total_records;
+    header->lawyer_count = lawyers.count;
+    header->word_count = words.count;
+    unsigned char *lawyer_names = store->owned + sizeof(compact_header);
+    unsigned char *word_names = lawyer_names + (size_t)lawyers.count * LAWYER_LEN;
+
+    uint32_t *by_name = work, *rank = work + max_count;
+    name_dict_ranks(&lawyers, by_name, rank);
+    for (uint32_t r = 0; r < lawyers.count; r++)
+        memcpy(lawyer_names + (size_t)r * LAWYER_LEN, name_dict_key(&lawyers, by_name[r]), LAWYER_LEN);
+    for (size_t i = 0; i < total_records; i++) rows[i].lawyer = rank[rows[i].lawyer];
+
+    name_dict_ranks(&words, by_name, rank);
+    for (uint32_t r = 0; r < words.count; r++)
+        memcpy(word_names + (size_t)r * WORD_LEN, name_dict_key(&words, by_name[r]), WORD_LEN);
+    for (size_t i = 0; i < total_records; i++)
+        for (int w = 0; w < COMPACT_WORDS; w++) rows[i].word[w] = rank[rows[i].word[w]];
+
+    memcpy(store->owned + offset, rows, total_records * sizeof(compact_row));
+    store->count = total_records;
+    store->lawyer_count = lawyers.count;
+    store->word_count = words.count;
+    store->lawyers = (const unsigned char (*)[LAWYER_LEN])lawyer_names;
+    store->words = (const unsigned char (*)[WORD_LEN])word_names;
+    store->rows = (const compact_row *)(store->owned + offset);
+
+    // Проверка без потерь
+    result = 0;
+    for (size_t i = 0; i < total_records && result == 0; i++) {
+        record rec;
+        compact_decode(store, i, &rec);
+        if (memcmp(&rec, &DB[i], sizeof(record)) != 0) result = -2;
+    }
+
+done:
+    if (result != 0 && store->owned != NULL) compact_free(store);
+    free(work);
+    free(rows);
+    if (words_ok == 0) name_dict_free(&words);
+    if (lawyers_ok == 0) name_dict_free(&lawyers);
+    return result;
+}
+
+// Размер сжатого представления в байтах (как в файле)
+size_t compact_size(const compact_store *store) {
+    return compact_rows_offset(store->lawyer_count, store->word_count) + store->count * sizeof(compact_row);
+}
+
+int compact_save(const char *path, const compact_store *store) {
+    char tmp_path[1040];
+    snprintf(tmp_path, sizeof(tmp_path), "%s.tmp", path);
+    FILE *fp = fopen(tmp_path, "wb");
+    if (fp == NULL) return -1;
+    const unsigned char *data = (const unsigned char *)store->lawyers - sizeof(compact_header);
+    size_t size = compact_size(store);
+    int ok = fwrite(data, 1, size, fp) == size;
+    ok = (fclose(fp) == 0) && ok;
+    if (ok) ok = replace_file(tmp_path, path) == 0;
+    if (!ok) remove(tmp_path);
+    return ok ? 0 : -1;
+}
+
+// Отображает сжатый файл и проверяет его размеры и коды словарей
+// Строка словаря из файла: текст, затем хотя бы один '\0' и только нули до конца
+static int zero_padded(const unsigned char *name, size_t len) {
+    size_t i = strnlen((const char *)name, len);
+    if (i == len) return 0;
+    while (i < len && name[i] == 0) i++;
+    return i == len;
+}
+
+int compact_open(compact_store *store, const char *path) {
+    memset(store, 0, sizeof(*store));
+    if (map_file(&store->map, path) != 0) return -1;
+    const compact_header *header = (const compact_header *)store->map.data;
+    size_t size = store->map.size;
+    // Счётчики из файла сравниваются делением, чтобы произведения не переполнялись
+    if (size < sizeof(compact_header) ||
+        memcmp(header->magic, COMPACT_MAGIC, sizeof(header->magic)) != 0 ||
+        header->lawyer_count > UINT32_MAX || header->word_count > UINT32_MAX ||
+        header->lawyer_count > size / LAWYER_LEN || header->word_count > size / WORD_LEN) {
+        unmap_file(&store->map);
+        return -1;
+    }
+    size_t rows_offset = compact_rows_offset(header->lawyer_count, header->word_count);
+    if (rows_offset > size || (size - rows_offset) % sizeof(compact_row) != 0 ||
+        header->record_count != (size - rows_offset) / sizeof(compact_row)) {
+        unmap_file(&store->map);
+        return -1;
+    }
+    const unsigned char *data = (const unsigned char *)store->map.data;
+    const unsigned char *names = data + sizeof(compact_header);
+    for (uint64_t k = 0; k < header->lawyer_count; k++) {
+        if (!zero_padded(names + k * LAWYER_LEN, LAWYER_LEN)) {
+            unmap_file(&store->map);
+            return -1;
+        }
+    }
+    names += header->lawyer_count * LAWYER_LEN;
+    for (uint64_t k = 0; k < header->word_count; k++) {
+        if (!zero_padded(names + k * WORD_LEN, WORD_LEN)) {
+            unmap_file(&store->map);
+            return -1;
+        }
+    }
+    store->count = (size_t)header->record_count;
+    store->lawyer_count = (uint32_t)header->lawyer_count;
+    store->word_count = (uint32_t)header->word_count;
+    store->lawyers = (const unsigned char (*)[LAWYER_LEN])(data + sizeof(compact_header));
+    store->words = (const unsigned char (*)[WORD_LEN])(data + sizeof(compact_header) +
+                                                      (size_t)store->lawyer_count * LAWYER_LEN);
+    store->rows = (const compact_row *)(data + rows_offset);
+    for (size_t i = 0; i < store->count; i++) {
+        const compact_row *row = &store->rows[i];
+        if (row->lawyer >= store->lawyer_count || row->word[0] >= store->word_count ||
+            row->word[1] >= store->word_count || row->word[2] >= store->word_count) {
+            unmap_file(&store->map);
+            return -1;
+        }
+    }
+    return 0;
+}
+
+// Сортировка по (адвокат, сумма) по одним кодам; порядок совпадает с radix_sort_order
+int compact_sort_order(const compact_store *store, uint32_t *order) {
+    size_t n = store->count;
+    sort_key *keys = (sort_key *)malloc((n ? n : 1) * sizeof(sort_key));
+    sort_key *tmp = (sort_key *)malloc((n ? n : 1) * sizeof(sort_key));
+    uint32_t *counts = (uint32_t *)calloc((size_t)RADIX_DIGITS * RADIX_SIZE, sizeof(uint32_t));
+    int result = -1;
+    if (keys != NULL && tmp != NULL && counts != NULL) {
+        for (size_t i = 0; i < n; i++) {
+            keys[i].key = (uint64_t)store->rows[i].lawyer << 16 | store->rows[i].amount;
+            keys[i].idx = (uint32_t)i;
+        }
+        const sort_key *sorted = n ? radix_sort_keys(keys, tmp, counts, n) : keys;
+        for (size_t i = 0; i < n; i++) order[i] = sorted[i].idx;
+        result = 0;
+    }
+    free(keys);
+    free(tmp);
+    free(counts);
+    return result;
+}
+
+// Диапазон кодов [begin, end) ФИО адвокатов, начинающихся с prefix
+static record_range compact_lawyer_codes(const compact_store *store, const char *prefix) {
+    size_t len = strlen(prefix);
+    if (len > LAWYER_LEN) len = LAWYER_LEN;
+    record_range codes = {0, store->lawyer_count};
+    size_t lo = 0, hi = store->lawyer_count;
+    while (lo < hi) {
+        size_t mid = lo + (hi - lo) / 2;
+        if (strncmp((const char *)store->lawyers[mid], prefix, len) < 0) lo = mid + 1;
+        else hi = mid;
+    }
+    codes.begin = lo;
+    hi = store->lawyer_count;
+    while (lo < hi) {
+        size_t mid = lo + (hi - lo) / 2;
+        if (strncmp((const char *)store->lawyers[mid], prefix, len) <= 0) lo = mid + 1;
+        else hi = mid;
+    }
+    codes.end = lo;
+    return codes;
+}
+
+// Первая позиция в order с кодом адвоката >= code
+static size_t compact_code_bound(const compact_store *store, const uint32_t *order, size_t code) {
+    size_t lo = 0, hi = store->count;
+    while (lo < hi) {
+        size_t mid = lo + (hi - lo) / 2;
+        if (store->rows[order[mid]].lawyer < code) lo = mid + 1;
+        else hi = mid;
+    }
+    return lo;
+}
+
+// Аналог find_lawyer_prefix для сжатого хранилища и compact_sort_order
+record_range compact_find_lawyer_prefix(const compact_store *store, const uint32_t *order, const char *prefix) {
+    record_range codes = compact_lawyer_codes(store, prefix);
+    record_range range;
+    range.begin = compact_code_bound(store, order, codes.begin);
+    range.end = codes.end > codes.begin ? compact_code_bound(store, order, codes.end) : range.begin;
+    return range;
+}
+
+// saod -E: база -> сжатый файл
+int compact_encode_file(const char *in_path, const char *out_path) {
+    record_db db;
+    if (db_open(&db, in_path) != 0) return -1;
+    compact_store store;
+    int result = compact_build(db.records, db.count, &store);
+    if (result == 0) {
+        printf("Записей: %zu, адвокатов: %u, слов ФИО: %u, размер: %zu -> %zu байт\n", store.count,
+               store.lawyer_count, store.word_count, db.map.size, compact_size(&store));
+        result = compact_save(out_path, &store);
+        compact_free(&store);
+    } else if (result == -2) {
+        printf("Записи базы не в формате fill_field, сжатие без потерь невозможно.\n");
+    }
+    db_close(&db);
+    return result;
+}
+
+// saod -D: сжатый файл -> база
+int compact_decode_file(const char *in_path, const char *out_path) {
+    compact_store store;
+    if (compact_open(&store, in_path) != 0) return -1;
+    FILE *fp = fopen(out_path, "wb");
+    int ok = fp != NULL;
+    for (size_t i = 0; ok && i < store.count; i++) {
+        record rec;
+        compact_decode(&store, i, &rec);
+        ok = fwrite(&rec, sizeof(rec), 1, fp) == 1;
+    }
+    if (fp != NULL) ok = (fclose(fp) == 0) && ok;
+    compact_free(&store);
+    return ok ? 0 : -1;
+}
+
+// ---- SIMD-поиск по ФИО без индекса ----
+// Запись занимает 64 байта, и каждое строковое поле целиком лежит в одном
+// 32-байтном окне записи: ФИО вкладчика - байты 0..29 окна [0, 32),
+// ФИО адвоката - байты 10..31 окна [32, 64). Для окна за одну-две команды
+// строятся битовые маски совпадений с первым и последним символом образца
+// и с '\0'; их пересечение даёт позиции-кандидаты, которые проверяются memcmp.
+// Используется AVX2, если процессор его поддерживает, иначе SSE2 или
+// обычный цикл.
+
+typedef struct scan_pattern
+{
+    size_t window;          // Смещение 32-байтного окна в записи (0 или 32)
+    unsigned shift;         // Смещение поля внутри окна
+    unsigned field_len;
+    const char *text;
+    unsigned len;
+    int substring;          // 0 - поиск по началу поля, 1 - подстрока
+} scan_pattern;
+
+// Инициализирует образец для поля lawyer (is_lawyer) или depositor
+int scan_pattern_init(scan_pattern *p, int is_lawyer, const char *text, int substring) {
+    size_t field = is_lawyer ? offsetof(record, lawyer) : offsetof(record, depositor);
+    p->window = is_lawyer ? 32 : 0;
+    p->shift = (unsigned)(field - p->window);
+    p->field_len = is_lawyer ? (unsigned)sizeof(((record *)0)->lawyer) : (unsigned)sizeof(((record *)0)->depositor);
+    p->text = text;
+    p->len = (unsigned)strlen(text);
+    p->substring = substring;
+    return (p->len >= 1 && p->len <= p->field_len) ? 0 : -1;
+}
+
+static inline unsigned ctz32(uint32_t x) {
+#ifdef __GNUC__
+    return (unsigned)__builtin_ctz(x);
+#else
+    unsigned n = 0;
+    while (!(x & 1)) {
+        x >>= 1;
+        n++;
+    }
+    return n;
+#endif
+}
+
+// Проверка одной записи по маскам окна: first/last - совпадения с первым и
+// последним символом образца, zero - нулевые байты
+static inline int scan_candidates(const record *rec, const scan_pattern *p,
+                                  uint32_t first, uint32_t last, uint32_t zero) {
+    const char *field = (const char *)rec + p->window + p->shift;
+    first >>= p->shift;
+    last >>= p->shift;
+    zero >>= p->shift;
+
+    // Строка поля кончается на первом '\0' (как для strncmp)
+    unsigned end = zero ? ctz32(zero) : p->field_len;
+    if (end > p->field_len) end = p->field_len;
+    if (p->len > end) return 0;
+
+    unsigned starts = p->substring ? end - p->len + 1 : 1;
+    uint32_t cand = first & (last >> (p->len - 1)) & ((starts >= 32) ? ~0u : ((1u << starts) - 1));
+    while (cand) {
+        if (memcmp(field + ctz32(cand), p->text, p->len) == 0) return 1;
+        cand &= cand - 1;
+    }
+    return 0;
+}
+
+static size_t scan_records_scalar(const record *DB, size_t total_records, const scan_pattern *p, uint32_t *out) {
+    unsigned char c_first = (unsigned char)p->text[0], c_last = (unsigned char)p->text[p->len - 1];
+    size_t found = 0;
+    for (size_t i = 0; i < total_records; i++) {
+        const unsigned char *w = (const unsigned char *)&DB[i] + p->window;
+        uint32_t first = 0, last = 0, zero = 0;
+        for (unsigned b = 0; b < 32; b++) {
+            first |= (uint32_t)(w[b] == c_first) << b;
+            last |= (uint32_t)(w[b] == c_last) << b;
+            zero |= (uint32_t)(w[b] == 0) << b;
+        }
+        if (scan_candidates(&DB[i], p, first, last, zero)) out[found++] = (uint32_t)i;
+    }
+    return found;
+}
+
+#ifdef HAVE_X86_SIMD
+__attribute__((target("sse2")))
+static size_t scan_records_sse2(const record *DB, size_t total_records, const scan_pattern *p, uint32_t *out) {
+    const __m128i v_first = _mm_set1_epi8(p->text[0]);
+    const __m128i v_last = _mm_set1_epi8(p->text[p->len - 1]);
+    const __m128i v_zero = _mm_setzero_si128();
+    size_t found = 0;
+    for (size_t i = 0; i < total_records; i++) {
+        const char *w = (const char *)&DB[i] + p->window;
+        __m128i lo = _mm_loadu_si128((const __m128i *)w);
+        __m128i hi = _mm_loadu_si128((const __m128i *)(w + 16));
+        uint32_t first = (uint32_t)_mm_movemask_epi8(_mm_cmpeq_epi8(lo, v_first)) |
+                         (uint32_t)_mm_movemask_epi8(_mm_cmpeq_epi8(hi, v_first)) << 16;
+        if (first == 0) continue;
+        uint32_t last = (uint32_t)_mm_movemask_epi8(_mm_cmpeq_epi8(lo, v_last)) |
+                        (uint32_t)_mm_movemask_epi8(_mm_cmpeq_epi8(hi, v_last)) << 16;
+        uint32_t zero = (uint32_t)_mm_movemask_epi8(_mm_cmpeq_epi8(lo, v_zero)) |
+                        (uint32_t)_mm_movemask_epi8(_mm_cmpeq_epi8(hi, v_zero)) << 16;
+        if (scan_candidates(&DB[i], p, first, last, zero)) out[found++] = (uint32_t)i;
+    }
+    return found;
+}
+
+__attribute__((target("avx2")))
+static size_t scan_records_avx2(const record *DB, size_t total_records, const scan_pattern *p, uint32_t *out) {
+    const __m256i v_first = _mm256_set1_epi8(p->text[0]);
+    const __m256i v_last = _mm256_set1_epi8(p->text[p->len - 1]);
+    const __m256i v_zero = _mm256_setzero_si256();
+    size_t found = 0;
+    for (size_t i = 0; i < total_records; i++) {
+        __m256i w = _mm256_loadu_si256((const __m256i *)((const char *)&DB[i] + p->window));
+        uint32_t first = (uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(w, v_first));
+        if (first == 0) continue;
+        uint32_t last = (uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(w, v_last));
+        uint32_t zero = (uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(w, v_zero));
+        if (scan_candidates(&DB[i], p, first, last, zero)) out[found++] = (uint32_t)i;
+    }
+    return found;
+}
+#endif
+
+// Номера записей (по порядку файла), поле которых содержит образец
+// (или начинается с него), пишутся в out. Возвращает их количество.
+size_t scan_records(const record *DB, size_t total_records, const scan_pattern *p, uint32_t *out) {
+#ifdef HAVE_X86_SIMD
+    if (__builtin_cpu_supports("avx2")) return scan_records_avx2(DB, total_records, p, out);
+    if (__builtin_cpu_supports("sse2")) return scan_records_sse2(DB, total_records, p, out);
+#endif
+    return scan_records_scalar(DB, total_records, p, out);
+}
+
+// ---- Кэш страниц и результатов поиска ----
+// Последние собранные страницы и первые страницы поиска по адвокату (вместе
+// с найденным диапазоном) хранятся по ключу запроса и вытесняются по
+// давности использования (LRU). Число ответов ограничено CACHE_SLOTS, объём
+// текста - CACHE_MAX_BYTES. Кэш сбрасывается, когда меняются размер или
+// время изменения файла базы, число записей в журнале или появляется
+// колоночное представление, из которого собираются страницы.
+
+#define CACHE_SLOTS 64
+#define CACHE_MAX_BYTES (8u << 20)
+#define CACHE_KEY_LEN 48
+
+typedef struct cache_entry
+{
+    char key[CACHE_KEY_LEN];    // "p <страница>" или "s <префикс>", пустой - ячейка свободна
+    uint64_t last_used;
+    record_range range;
+    text_buf text;
+} cache_entry;
+
+typedef struct result_cache
+{
+    cache_entry slots[CACHE_SLOTS];
+    uint64_t clock;
+    size_t bytes;
+    uint64_t hits;
+    uint64_t misses;
+    uint64_t evictions;
+    uint64_t resets;
+    uint64_t file_size;     // Состояние базы, для которого верен кэш
+    int64_t mtime;
+    size_t delta_count;
+    int columns;            // Страницы собраны из колонок
+} result_cache;
+
+void cache_init(result_cache *c) {
+    memset(c, 0, sizeof(*c));
+}
+
+static void cache_drop(result_cache *c, cache_entry *e) {
+    c->bytes -= e->text.len;
+    tb_free(&e->text);
+    e->key[0] = '\0';
+}
+
+void cache_clear(result_cache *c) {
+    for (int i = 0; i < CACHE_SLOTS; i++)
+        if (c->slots[i].key[0]) cache_drop(c, &c->slots[i]);
+}
+
+// Сбрасывает кэш, если база, журнал или колонки изменились с прошлой проверки
+void cache_validate(result_cache *c, const char *db_path, size_t delta_count, int columns) {
+    struct stat st;
+    uint64_t file_size = 0;
+    int64_t mtime = 0;
+    if (stat(db_path, &st) == 0) {
+        file_size = (uint64_t)st.st_size;
+        mtime = (int64_t)st.st_mtime;
+    }
+    if (file_size == c->file_size && mtime == c->mtime && delta_count == c->delta_count && columns == c->columns)
+        return;
+    if (c->bytes > 0) c->resets++;
+    cache_clear(c);
+    c->file_size = file_size;
+    c->mtime = mtime;
+    c->delta_count = delta_count;
+    c->columns = columns;
+}
+
+// Ответ по ключу или NULL, не влияя на вытеснение и статистику
+const cache_entry *cache_peek(const result_cache *c, const char *key) {
+    if (strlen(key) >= CACHE_KEY_LEN) return NULL;
+    for (int i = 0; i < CACHE_SLOTS; i++)
+        if (c->slots[i].key[0] && strcmp(c->slots[i].key, key) == 0) return &c->slots[i];
+    return NULL;
+}
+
+// Ответ по ключу или NULL; найденный ответ становится самым свежим
+const cache_entry *cache_get(result_cache *c, const char *key) {
+    cache_entry *e = (cache_entry *)cache_peek(c, key);
+    if (e == NULL) {
+        c->misses++;
+        return NULL;
+    }
+    e->last_used = ++c->clock;
+    c->hits++;
+    return e;
+}
+
+static cache_entry *cache_oldest(result_cache *c) {
+    cache_entry *oldest = NULL;
+    for (int i = 0; i < CACHE_SLOTS; i++)
+        if (c->slots[i].key[0] && (oldest == NULL || c->slots[i].last_used < oldest->last_used))
+            oldest = &c->slots[i];
+    return oldest;
+}
+
+// Сохраняет копию ответа, вытесняя самые давние. Слишком большие ответы
+// (больше четверти объёма) не кэшируются.
+void cache_put(result_cache *c, const char *key, const text_buf *text, record_range range) {
+    if (text->failed || strlen(key) >= CACHE_KEY_LEN || text->len > CACHE_MAX_BYTES / 4) return;
+    while (c->bytes + text->len > CACHE_MAX_BYTES) {
+        cache_drop(c, cache_oldest(c));
+        c->evictions++;
+    }
+    cache_entry *e = NULL;
+    for (int i = 0; i < CACHE_SLOTS && e == NULL; i++)
+        if (!c->slots[i].key[0]) e = &c->slots[i];
+    if (e == NULL) {
+        e = cache_oldest(c);
+        cache_drop(c, e);
+        c->evictions++;
+    }
+    tb_append(&e->text, text->data, text->len);
+    if (e->text.len != text->len) {
+        tb_free(&e->text);  // Нехватка памяти: ответ просто не кэшируется
+        return;
+    }
+    snprintf(e->key, sizeof(e->key), "%s", key);
+    e->range = range;
+    e->last_used = ++c->clock;
+    c->bytes += e->text.len;
+}
+
+void print_cache_stats(const result_cache *c) {
+    int used = 0;
+    for (int i = 0; i < CACHE_SLOTS; i++)
+        if (c->slots[i].key[0]) used++;
+    uint64_t lookups = c->hits + c->misses;
+    printf("\nКэш: ответов %d из %d, объём %.1f КБ из %u КБ\n", used, CACHE_SLOTS,
+           (double)c->bytes / 1024.0, CACHE_MAX_BYTES / 1024);
+    printf("Попаданий: %llu, промахов: %llu, доля попаданий: %.1f%%\n",
+           (unsigned long long)c->hits, (unsigned long long)c->misses,
+           lookups ? 100.0 * (double)c->hits / (double)lookups : 0.0);
+    printf("Вытеснено: %llu, сбросов из-за изменения базы: %llu\n",
+           (unsigned long long)c->evictions, (unsigned long long)c->resets);
+}
+
+// ---- Курсор результатов поиска ----
+// Поиск возвращает не напечатанный список, а курсор, по которому листает
+// обычный пейджер: на экран собираются только PAGE_SIZE видимых строк.
+// Курсор бывает трёх видов: диапазон объединённого вида (поиск по началу ФИО
+// адвоката - два бинарных поиска), готовый список номеров (запросы, top-K,
+// нечёткий поиск) и ленивый просмотр базы (подстрока): записи проверяются
+// блоками ровно до тех пор, пока не наберётся нужная страница, поэтому
+// первая страница появляется за время, не зависящее от числа совпадений.
+
+#define CURSOR_SCAN_BLOCK 8192  // Записей, проверяемых за один шаг просмотра
+
+typedef enum cursor_kind
+{
+    CURSOR_RANGE,
+    CURSOR_IDS,
+    CURSOR_SCAN
+} cursor_kind;
+
+typedef struct result_cursor
+{
+    cursor_kind kind;
+    const merged_view *view;    // CURSOR_RANGE: позиции range в объединённом виде
+    record_range range;
+    const record *DB;           // CURSOR_IDS, CURSOR_SCAN: номера записей DB
+    uint32_t *ids;
+    size_t count;               // Сколько номеров уже известно
+    size_t cap;
+    scan_pattern scan;          // CURSOR_SCAN: образец и следующая непроверенная запись
+    size_t next;
+    size_t total_records;
+} result_cursor;
+
+void cursor_range(result_cursor *cur, const merged_view *view, record_range range) {
+    memset(cur, 0, sizeof(*cur));
+    cur->kind = CURSOR_RANGE;
+    cur->view = view;
+    cur->range = range;
+}
+
+// Курсор забирает массив ids (освобождается в cursor_free)
+void cursor_ids(result_cursor *cur, const record *DB, uint32_t *ids, size_t count) {
+    memset(cur, 0, sizeof(*cur));
+    cur->kind = CURSOR_IDS;
+    cur->DB = DB;
+    cur->ids = ids;
+    cur->count = count;
+    cur->cap = count;
+}
+
+void cursor_scan(result_cursor *cur, const record *DB, size_t total_records, const scan_pattern *scan) {
+    memset(cur, 0, sizeof(*cur));
+    cur->kind = CURSOR_SCAN;
+    cur->DB = DB;
+    cur->scan = *scan;
+    cur->total_records = total_records;
+}
+
+void cursor_free(result_cursor *cur) {
+    free(cur->ids);
+    memset(cur, 0, sizeof(*cur));
+}
+
+// Все совпадения известны (для просмотра - база проверена до конца)
+int cursor_done(const result_cursor *cur) {
+    return cur->kind != CURSOR_SCAN || cur->next >= cur->total_records;
+}
+
+size_t cursor_known(const result_cursor *cur) {
+    return cur->kind == CURSOR_RANGE ? cur->range.end - cur->range.begin : cur->count;
+}
+
+// Продолжает просмотр, пока не известно want совпадений или база не кончится.
+// Возвращает -1 при нехватке памяти.
+int cursor_fill(result_cursor *cur, size_t want) {
+    while (cur->kind == CURSOR_SCAN && cur->count < want && cur->next < cur->total_records) {
+        size_t block = cur->total_records - cur->next;
+        if (block > CURSOR_SCAN_BLOCK) block = CURSOR_SCAN_BLOCK;
+        if (cur->count + block > cur->cap) {
+            size_t cap = cur->cap ? cur->cap * 2 : CURSOR_SCAN_BLOCK;
+            while (cap < cur->count + block) cap *= 2;
+            uint32_t *ids = (uint32_t *)realloc(cur->ids, cap * sizeof(uint32_t));
+            if (ids == NULL) return -1;
+            cur->ids = ids;
+            cur->cap = cap;
+        }
+        size_t found = scan_records(cur->DB + cur->next, block, &cur->scan, cur->ids + cur->count);
+        for (size_t k = 0; k < found; k++) cur->ids[cur->count + k] += (uint32_t)cur->next;
+        cur->count += found;
+        cur->next += block;
+    }
+    return 0;
+}
+
+// Строки [start, end) курсора; читаются только эти записи
+void tb_cursor_rows(text_buf *tb, const result_cursor *cur, size_t start, size_t end) {
+    if (cur->kind == CURSOR_RANGE) {
+        merged_pos pos = merged_locate(cur->view, cur->range.begin + start);
+        for (size_t i = start; i < end; i++) {
+            uint32_t base_id;
+            tb_record(tb, merged_next(cur->view, &pos, &base_id));
+        }
+    } else {
+        for (size_t i = start; i < end; i++) tb_record(tb, &cur->DB[cur->ids[i]]);
+    }
+}
+
+// Постраничный просмотр курсора теми же командами, что и основное окно;
+// [q] возвращает к базе. pattern (CP866) выводится в заголовке в кавычках.
+// Если задан cache, первая страница берётся из кэша по ключу key или
+// собирается и сохраняется туда вместе с диапазоном курсора.
+void browse_cursor(result_cursor *cur, const char *title, const char *pattern, result_cache *cache,
+                   const char *key) {
+    text_buf tb = {0}, body = {0};
+    size_t page = 0;
+    int command;
+    do {
+        // Ещё одна запись сверх страницы показывает, есть ли следующая
+        int fill_failed = cursor_fill(cur, (page + 1) * PAGE_SIZE + 1) != 0;
+        size_t known = cursor_known(cur);
+        size_t last_page = known ? (known - 1) / PAGE_SIZE : 0;
+        if (page > last_page) page = last_page;
+        size_t start = page * PAGE_SIZE;
+        size_t end = start + PAGE_SIZE;
+        if (end > known) end = known;
+
+        const cache_entry *hit = (cache != NULL && page == 0) ? cache_get(cache, key) : NULL;
+        tb_append(&tb, ANSI_CLEAR, strlen(ANSI_CLEAR));
+        if (hit != NULL) {
+            tb_append_buf(&tb, &hit->text);
+        } else {
+            tb_clear(&body);
+            tb_printf(&body, "%s", title);
+            if (pattern != NULL) {
+                tb_append(&body, " \"", 2);
+                tb_cp866(&body, pattern, strlen(pattern), 0);
+                tb_append(&body, "\"", 1);
+            }
+            if (cursor_done(cur))
+                tb_printf(&body, ": найдено записей %zu, страница %zu/%zu\n", known, page + 1, last_page + 1);
+            else
+                tb_printf(&body, ": найдено не менее %zu, страница %zu\n", known, page + 1);
+            tb_header(&body);
+            tb_cursor_rows(&body, cur, start, end);
+            if (fill_failed) tb_printf(&body, "Недостаточно памяти, показаны не все записи.\n");
+            else if (cache != NULL && page == 0) cache_put(cache, key, &body, cur->range);
+            tb_append_buf(&tb, &body);
+        }
+        tb_printf(&tb, "\nКоманды: [n] +1  [p] -1  [N] +10  [P] -10  [q] к базе: ");
+        tb_flush(&tb);
+
+        command = read_command();
+        if (command == 'n') page++;
+        else if (command == 'p' && page > 0) page--;
+        else if (command == 'N') page += 10;
+        else if (command == 'P') page = page > 10 ? page - 10 : 0;
+    } while (command != 'q' && command != 'Q');
+    tb_free(&tb);
+    tb_free(&body);
+}
+
+// ---- Группировка по адвокатам ----
+// Для каждого адвоката считаются число вкладов, их сумма, минимум, максимум
+// и гистограмма сумм. В пейджере база уже упорядочена по адвокату, поэтому
+// группы - это подряд идущие записи объединённого вида: он делится на куски
+// по потокам, каждый поток копит свои группы, а группы на стыках кусков
+// сливаются. Пакетный режим (-g) обходится без сортировки: каждый поток
+// собирает группы своей части файла в хеш-таблицу, затем частичные итоги
+// сливаются и упорядочиваются по ФИО.
+
+#define HIST_BUCKETS 8
+#define HIST_WIDTH 8192     // Ширина интервала гистограммы сумм
+
+typedef struct lawyer_stats
+{
+    unsigned char name[LAWYER_LEN];  // Нормализованное ФИО (normalize_lawyer)
+    uint64_t count;
+    uint64_t sum;
+    unsigned min;
+    unsigned max;
+    uint64_t hist[HIST_BUCKETS];
+} lawyer_stats;
+
+typedef struct lawyer_report
+{
+    lawyer_stats *groups;
+    size_t count;
+    size_t cap;
+} lawyer_report;
+
+void report_free(lawyer_report *r) {
+    free(r->groups);
+    memset(r, 0, sizeof(*r));
+}
+
+static lawyer_stats *report_add_group(lawyer_report *r, const unsigned char *name) {
+    if (r->count == r->cap) {
+        size_t cap = r->cap ? r->cap * 2 : 64;
+        lawyer_stats *groups = (lawyer_stats *)realloc(r->groups, cap * sizeof(lawyer_stats));
+        if (groups == NULL) return NULL;
+        r->groups = groups;
+        r->cap = cap;
+    }
+    lawyer_stats *g = &r->groups[r->count++];
+    memset(g, 0, sizeof(*g));
+    memcpy(g->name, name, LAWYER_LEN);
+    g->min = 0xFFFF;
+    return g;
+}
+
+static void stats_add(lawyer_stats *g, unsigned amount) {
+    g->count++;
+    g->sum += amount;
+    if (amount < g->min) g->min = amount;
+    if (amount > g->max) g->max = amount;
+    g->hist[amount / HIST_WIDTH]++;
+}
+
+static void stats_merge(lawyer_stats *into, const lawyer_stats *from) {
+    into->count += from->count;
+    into->sum += from->sum;
+    if (from->min < into->min) into->min = from->min;
+    if (from->max > into->max) into->max = from->max;
+    for (int b = 0; b < HIST_BUCKETS; b++) into->hist[b] += from->hist[b];
+}
+
+// Задача потока: кусок [begin, end) объединённого вида или файла
+typedef struct aggregate_task
+{
+    const merged_view *view;    // Для группировки по упорядоченному виду
+    const record *DB;           // Для хеш-группировки файла
+    size_t begin;
+    size_t end;
+    lawyer_report report;
+    int result;
+} aggregate_task;
+
+static void *aggregate_sorted_run(void *arg) {
+    aggregate_task *task = (aggregate_task *)arg;
+    merged_pos pos = merged_locate(task->view, task->begin);
+    lawyer_stats *g = NULL;
+    task->result = 0;
+    for (size_t k = task->begin; k < task->end; k++) {
+        uint32_t base_id;
+        const record *rec = merged_next(task->view, &pos, &base_id);
+        unsigned char name[LAWYER_LEN];
+        normalize_lawyer(rec->lawyer, name);
+        if (g == NULL || memcmp(g->name, name, LAWYER_LEN) != 0) {
+            g = report_add_group(&task->report, name);
+            if (g == NULL) {
+                task->result = -1;
+                return NULL;
+            }
+        }
+        stats_add(g, rec->amount);
+    }
+    return NULL;
+}
+
+static void *aggregate_hash_run(void *arg) {
+    aggregate_task *task = (aggregate_task *)arg;
+    name_dict dict;
+    task->result = -1;
+    if (name_dict_init(&dict, LAWYER_LEN) != 0) {
+        name_dict_free(&dict);
+        return NULL;
+    }
+    for (size_t i = task->begin; i < task->end; i++) {
+        const record *rec = &task->DB[i];
+        unsigned char name[LAWYER_LEN];
+        normalize_lawyer(rec->lawyer, name);
+        uint32_t id = name_dict_insert(&dict, name);
+        if (id == UINT32_MAX) goto done;
+        // Номера в словаре выдаются подряд, поэтому группа id - это groups[id]
+        if (id == task->report.count && report_add_group(&task->report, name) == NULL) goto done;
+        stats_add(&task->report.groups[id], rec->amount);
+    }
+    task->result = 0;
+done:
+    name_dict_free(&dict);
+    return NULL;
+}
+
+static int compare_stats_name(const void *a, const void *b) {
+    return memcmp(((const lawyer_stats *)a)->name, ((const lawyer_stats *)b)->name, LAWYER_LEN);
+}
+
+// Группировка в thread_count потоков. Если view задан, используются
+// упорядоченные серии объединённого вида, иначе - хеш-группировка DB.
+// Группы результата упорядочены по ФИО адвоката. Возвращает 0 при успехе.
+int aggregate_lawyers(const merged_view *view, const record *DB, size_t total_records,
+                      int thread_count, lawyer_report *out) {
+    memset(out, 0, sizeof(*out));
+    if (view != NULL) total_records = merged_count(view);
+    if (thread_count > 64) thread_count = 64;
+    if (thread_count < 1 || total_records < PARALLEL_SORT_MIN) thread_count = 1;
+
+    aggregate_task tasks[64];
+    memset(tasks, 0, sizeof(tasks));
+    for (int t = 0; t < thread_count; t++) {
+        tasks[t].view = view;
+        tasks[t].DB = DB;
+        tasks[t].begin = total_records * (size_t)t / (size_t)thread_count;
+        tasks[t].end = total_records * (size_t)(t + 1) / (size_t)thread_count;
+    }
+    run_tasks(view != NULL ? aggregate_sorted_run : aggregate_hash_run,
+              tasks, sizeof(aggregate_task), thread_count);
+
+    int result = 0;
+    for (int t = 0; t < thread_count; t++)
+        if (tasks[t].result != 0) result = -1;
+
+    if (result == 0 && view != NULL) {
+        // Куски упорядочены, сливаются только одинаковые группы на стыках
+        for (int t = 0; t < thread_count && result == 0; t++) {
+            lawyer_report *part = &tasks[t].report;
+            for (size_t i = 0; i < part->count; i++) {
+                lawyer_stats *last = out->count ? &out->groups[out->count - 1] : NULL;
+                if (last != NULL && memcmp(last->name, part->groups[i].name, LAWYER_LEN) == 0) {
+                    stats_merge(last, &part->groups[i]);
+                } else if ((last = report_add_group(out, part->groups[i].name)) != NULL) {
+                    *last = part->groups[i];
+                } else {
+                    result = -1;
+                    break;
+                }
+            }
+        }
+    } else if (result == 0) {
+        // Частичные итоги потоков сливаются по ФИО через общий словарь
+        name_dict dict;
+        if (name_dict_init(&dict, LAWYER_LEN) != 0) result = -1;
+        for (int t = 0; t < thread_count && result == 0; t++) {
+            lawyer_report *part = &tasks[t].report;
+            for (size_t i = 0; i < part->count; i++) {
+                uint32_t id = name_dict_insert(&dict, part->groups[i].name);
+                if (id == UINT32_MAX) {
+                    result = -1;
+                    break;
+                }
+                if (id == out->count) {
+                    lawyer_stats *g = report_add_group(out, part->groups[i].name);
+                    if (g == NULL) {
+                        result = -1;
+                        break;
+                    }
+                    *g = part->groups[i];
+                } else {
+                    stats_merge(&out->groups[id], &part->groups[i]);
+                }
+            }
+        }
+        name_dict_free(&dict);
+        if (result == 0) qsort(out->groups, out->count, sizeof(lawyer_stats), compare_stats_name);
+    }
+
+    for (int t = 0; t < thread_count; t++) report_free(&tasks[t].report);
+    if (result != 0) report_free(out);
+    return result;
+}
+
+// Таблица итогов по адвокатам
+void tb_report(text_buf *tb, const lawyer_report *r) {
+    tb_utf8(tb, "Адвокат", 23);
+    tb_utf8(tb, " Вкладов        Сумма    Мин   Макс  Средний", 45);
+    for (int b = 0; b < HIST_BUCKETS; b++) tb_printf(tb, " <%-5d", (b + 1) * HIST_WIDTH);
+    tb_append(tb, "\n", 1);
+
+    uint64_t total_count = 0, total_sum = 0;
+    for (size_t i = 0; i < r->count; i++) {
+        const lawyer_stats *g = &r->groups[i];
+        tb_cp866(tb, (const char *)g->name, LAWYER_LEN, 23);
+        tb_printf(tb, "%8llu %12llu %6u %6u %8.0f", (unsigned long long)g->count,
+                  (unsigned long long)g->sum, g->min, g->max, (double)g->sum / (double)g->count);
+        for (int b = 0; b < HIST_BUCKETS; b++) tb_printf(tb, " %6llu", (unsigned long long)g->hist[b]);
+        tb_append(tb, "\n", 1);
+        total_count += g->count;
+        total_sum += g->sum;
+    }
+    tb_printf(tb, "\nАдвокатов: %zu, вкладов: %llu, сумма: %llu\n", r->count,
+              (unsigned long long)total_count, (unsigned long long)total_sum);
+}
+
+void print_report(const lawyer_report *r) {
+    text_buf tb = {0};
+    tb_report(&tb, r);
+    tb_flush(&tb);
+    tb_free(&tb);
+}
+
+// ---- Триграммный индекс ФИО (<база>.tri) ----
+// Для каждой тройки подряд идущих символов ФИО вкладчика и адвоката хранится
+// список номеров записей, где она встречается. Символы приводятся к 64-буквенному
+// алфавиту (строчные буквы, Ё = Е, цифры и знаки склеены), поэтому ключ
+// триграммы - 18 бит и списки лежат в прямой таблице смещений. Номера в списке
+// возрастают и хранятся разностями в коде переменной длины (7 бит на байт).
+// Индекс строится при первом поиске и сохраняется рядом с базой; годность
+// проверяется тем же заголовком, что и у <база>.idx, и проходом по всем
+// спискам. Записи журнала .delta в индекс не входят до уплотнения базы.
+//
+// Поиск с k опечатками опирается на то, что одна правка портит не больше трёх
+// триграмм образца: кандидаты - записи, где есть хотя бы (число различных
+// триграмм образца - 3k) из них. Для кандидатов считается расстояние
+// Левенштейна от образца до ближайшей подстроки поля; при k = 0 это поиск
+// подстроки без учёта регистра. Если порог не положителен (короткий образец),
+// проверяются все записи.
+
+#define TRIGRAM_MAGIC "SAODTRI1"
+#define TRIGRAM_ALPHABET 64
+#define TRIGRAM_KEYS (TRIGRAM_ALPHABET * TRIGRAM_ALPHABET * TRIGRAM_ALPHABET)
+#define TRIGRAM_FIELDS 2    // 0 - ФИО вкладчика, 1 - ФИО адвоката
+#define TRIGRAM_LISTS (TRIGRAM_FIELDS * TRIGRAM_KEYS)
 
-typedef struct record
+typedef struct trigram_index
 {
-    char depositor[30];     // ФИО вкладчика (30 символов)
-    unsigned short amount;  // Сумма вклада (unsigned short int)
-    char date[10];          // Дата вклада (10 символов)
-    char lawyer[22];        // ФИО адвоката (22 символа)
-} record;
+    const uint64_t *offsets;        // TRIGRAM_LISTS + 1 смещений списков
+    const unsigned char *postings;  // Списки номеров записей
+    unsigned char *owned;           // Память построенного индекса (NULL, если отображён)
+    file_map map;
+} trigram_index;
 
-// Функция сравнения для сортировки по ФИО адвоката и сумме вклада
-int compare_records(const void *a, const void *b) {
-    const record *rec_a = (const record *)a;
-    const record *rec_b = (const record *)b;
-    
-    // Сравниваем ФИО адвоката
-    int lawyer_cmp = strncmp(rec_a->lawyer, rec_b->lawyer, 22);
-    if (lawyer_cmp != 0) {
-        return lawyer_cmp;
+// Символ CP866 в алфавите индекса: 1-32 - русские буквы, 33-58 - латинские,
+// 59 - цифры, 0 - пробел и прочие знаки
+static unsigned char trigram_symbol(unsigned char c) {
+    if (c >= 0x80 && c <= 0x8F) c += 0x20;          // А-П -> а-п
+    else if (c >= 0x90 && c <= 0x9F) c += 0x50;     // Р-Я -> р-я
+    else if (c == 0xF0 || c == 0xF1) c = 0xA5;      // Ё, ё -> е
+    if (c >= 0xA0 && c <= 0xAF) return (unsigned char)(1 + c - 0xA0);
+    if (c >= 0xE0 && c <= 0xEF) return (unsigned char)(17 + c - 0xE0);
+    if (c >= 'A' && c <= 'Z') c += 'a' - 'A';
+    if (c >= 'a' && c <= 'z') return (unsigned char)(33 + c - 'a');
+    if (c >= '0' && c <= '9') return 59;
+    return 0;
+}
+
+static unsigned char trigram_table[256];
+
+static void trigram_table_init(void) {
+    for (int c = 0; c < 256; c++) trigram_table[c] = trigram_symbol((unsigned char)c);
+}
+
+// Поле без завершающих пробелов в алфавите индекса. Возвращает длину.
+static size_t trigram_fold(const char *text, size_t len, unsigned char *out) {
+    field_view v = field_trim(text, len);
+    for (size_t i = 0; i < v.len; i++) out[i] = trigram_table[(unsigned char)v.data[i]];
+    return v.len;
+}
+
+static size_t trigram_fold_field(const record *rec, int field, unsigned char *out) {
+    return field ? trigram_fold(rec->lawyer, LAWYER_LEN, out)
+                 : trigram_fold(rec->depositor, DEPOSITOR_LEN, out);
+}
+
+static uint32_t trigram_key(int field, const unsigned char *s) {
+    return (uint32_t)field * TRIGRAM_KEYS +
+           ((uint32_t)s[0] * TRIGRAM_ALPHABET + s[1]) * TRIGRAM_ALPHABET + s[2];
+}
+
+static size_t varint_len(uint32_t v) {
+    size_t len = 1;
+    while (v >= 0x80) {
+        v >>= 7;
+        len++;
     }
-    
-    // Если ФИО адвоката совпадают, сравниваем сумму вклада
-    if (rec_a->amount < rec_b->amount) return -1;
-    if (rec_a->amount > rec_b->amount) return 1;
+    return len;
+}
+
+void trigram_free(trigram_index *idx) {
+    if (idx->owned != NULL) free(idx->owned);
+    else unmap_file(&idx->map);
+    memset(idx, 0, sizeof(*idx));
+}
+
+// Строит индекс в памяти в два прохода: сначала размеры списков, затем сами
+// списки. next[key] - номер, следующий за последним записанным в список,
+// он же отсекает повторы триграммы внутри одного поля.
+int trigram_build(const record *DB, size_t total_records, trigram_index *idx) {
+    memset(idx, 0, sizeof(*idx));
+    uint64_t *offsets = (uint64_t *)calloc(TRIGRAM_LISTS + 1, sizeof(uint64_t));
+    uint32_t *next = (uint32_t *)calloc(TRIGRAM_LISTS, sizeof(uint32_t));
+    if (offsets == NULL || next == NULL) goto fail;
+    trigram_table_init();
+
+    unsigned char text[DEPOSITOR_LEN];
+    for (size_t id = 0; id < total_records; id++) {
+        for (int field = 0; field < TRIGRAM_FIELDS; field++) {
+            size_t len = trigram_fold_field(&DB[id], field, text);
+            for (size_t i = 0; i + 3 <= len; i++) {
+                uint32_t key = trigram_key(field, text + i);
+                if (next[key] == id + 1) continue;
+                offsets[key + 1] += varint_len((uint32_t)id - next[key]);
+                next[key] = (uint32_t)id + 1;
+            }
+        }
+    }
+    for (size_t key = 0; key < TRIGRAM_LISTS; key++) offsets[key + 1] += offsets[key];
+
+    unsigned char *postings = (unsigned char *)malloc(offsets[TRIGRAM_LISTS] ? offsets[TRIGRAM_LISTS] : 1);
+    if (postings == NULL) goto fail;
+    memset(next, 0, TRIGRAM_LISTS * sizeof(uint32_t));
+    // Курсоры записи: смещения сдвигаются к концу списков и восстанавливаются
+    for (size_t id = 0; id < total_records; id++) {
+        for (int field = 0; field < TRIGRAM_FIELDS; field++) {
+            size_t len = trigram_fold_field(&DB[id], field, text);
+            for (size_t i = 0; i + 3 <= len; i++) {
+                uint32_t key = trigram_key(field, text + i);
+                if (next[key] == id + 1) continue;
+                uint32_t gap = (uint32_t)id - next[key];
+                unsigned char *out = postings + offsets[key]++;
+                while (gap >= 0x80) {
+                    *out++ = (unsigned char)(gap | 0x80);
+                    offsets[key]++;
+                    gap >>= 7;
+                }
+                *out = (unsigned char)gap;
+                next[key] = (uint32_t)id + 1;
+            }
+        }
+    }
+    for (size_t key = TRIGRAM_LISTS; key > 0; key--) offsets[key] = offsets[key - 1];
+    offsets[0] = 0;
+    free(next);
+
+    // Смещения и списки в одном блоке, как в файле
+    size_t table_size = (TRIGRAM_LISTS + 1) * sizeof(uint64_t);
+    idx->owned = (unsigned char *)realloc(offsets, table_size + offsets[TRIGRAM_LISTS]);
+    if (idx->owned == NULL) {
+        free(postings);
+        free(offsets);
+        return -1;
+    }
+    offsets = (uint64_t *)idx->owned;
+    memcpy(idx->owned + table_size, postings, offsets[TRIGRAM_LISTS]);
+    free(postings);
+    idx->offsets = offsets;
+    idx->postings = idx->owned + table_size;
     return 0;
+fail:
+    free(next);
+    free(offsets);
+    return -1;
 }
 
-// Функция для получения первых трех букв фамилии адвоката
-void get_lawyer_surname_prefix(const char *lawyer, char *prefix) {
-    // Копируем первые 3 символа
-    strncpy(prefix, lawyer, 3);
-    prefix[3] = '\0';
+static void trigram_header(index_header *header, const record_db *db, const char *db_path) {
+    fill_index_header(header, db, db_path);
+    memcpy(header->magic, TRIGRAM_MAGIC, sizeof(header->magic));
 }
 
-// Функция бинарного поиска по первым трем буквам фамилии адвоката
-void search_by_lawyer_prefix(record *DB, int total_records, const char *search_prefix) {
-    printf("\nРезультаты поиска по адвокату \"%s\":\n", search_prefix);
-    printf("-------------------------------------------------------------------------------\n");
-    
-    int found = 0;
-    for (int i = 0; i < total_records; i++) {
-        char current_prefix[4];
-        get_lawyer_surname_prefix(DB[i].lawyer, current_prefix);
-        
-        if (strncmp(current_prefix, search_prefix, 3) == 0) {
-            printf("%-30s %-6hu %-10s %-22s\n", 
-                   DB[i].depositor, 
-                   DB[i].amount, 
-                   DB[i].date, 
-                   DB[i].lawyer);
+void trigram_path(const char *db_path, char *out, size_t out_size) {
+    snprintf(out, out_size, "%s.tri", db_path);
+}
+
+// Отображает сохранённый индекс, если он построен для текущей базы
+// Проверяет прочитанный с диска индекс: смещения не убывают и не выходят за
+// область списков, каждое число списка закончено внутри своего списка, а
+// номера возрастают и меньше count
+static int trigram_valid(const uint64_t *offsets, const unsigned char *postings, uint64_t size, size_t count) {
+    if (offsets[0] != 0) return 0;
+    for (size_t key = 0; key < TRIGRAM_LISTS; key++) {
+        if (offsets[key + 1] < offsets[key] || offsets[key + 1] > size) return 0;
+        const unsigned char *p = postings + offsets[key];
+        const unsigned char *end = postings + offsets[key + 1];
+        uint64_t next = 0;
+        while (p < end) {
+            uint64_t gap = 0;
+            int shift = 0;
+            for (;; shift += 7) {
+                if (p == end || shift > 28) return 0;
+                gap |= (uint64_t)(*p & 0x7F) << shift;
+                if (!(*p++ & 0x80)) break;
+            }
+            if (next + gap >= count) return 0;
+            next += gap + 1;
+        }
+    }
+    return 1;
+}
+
+int trigram_open(trigram_index *idx, const char *db_path, const record_db *db) {
+    char path[1024];
+    trigram_path(db_path, path, sizeof(path));
+    memset(idx, 0, sizeof(*idx));
+    if (map_file(&idx->map, path) != 0) return -1;
+
+    index_header expected;
+    trigram_header(&expected, db, db_path);
+    size_t table_size = sizeof(index_header) + (TRIGRAM_LISTS + 1) * sizeof(uint64_t);
+    const unsigned char *data = (const unsigned char *)idx->map.data;
+    if (idx->map.size < table_size || memcmp(data, &expected, sizeof(index_header)) != 0 ||
+        ((const uint64_t *)(data + sizeof(index_header)))[TRIGRAM_LISTS] != idx->map.size - table_size ||
+        !trigram_valid((const uint64_t *)(data + sizeof(index_header)), data + table_size,
+                       idx->map.size - table_size, db->count)) {
+        unmap_file(&idx->map);
+        return -1;
+    }
+    idx->offsets = (const uint64_t *)(data + sizeof(index_header));
+    idx->postings = data + table_size;
+    return 0;
+}
+
+// Сохраняет индекс через временный файл, как index_save
+int trigram_save(const char *db_path, const record_db *db, const trigram_index *idx) {
+    char path[1024], tmp_path[1040];
+    trigram_path(db_path, path, sizeof(path));
+    snprintf(tmp_path, sizeof(tmp_path), "%s.tmp", path);
+
+    FILE *fp = fopen(tmp_path, "wb");
+    if (fp == NULL) return -1;
+
+    index_header header;
+    trigram_header(&header, db, db_path);
+    size_t postings_size = (size_t)idx->offsets[TRIGRAM_LISTS];
+    int ok = fwrite(&header, sizeof(header), 1, fp) == 1 &&
+             fwrite(idx->offsets, sizeof(uint64_t), TRIGRAM_LISTS + 1, fp) == TRIGRAM_LISTS + 1 &&
+             fwrite(idx->postings, 1, postings_size, fp) == postings_size;
+    ok = (fclose(fp) == 0) && ok;
+    if (ok) ok = replace_file(tmp_path, path) == 0;
+    if (!ok) remove(tmp_path);
+    return ok ? 0 : -1;
+}
+
+// Расстояние Левенштейна от образца до ближайшей подстроки текста (начало
+// и конец подстроки бесплатны). Битовый алгоритм Майерса: столбец таблицы
+// расстояний хранится разностями соседних клеток в двух словах, образец
+// длиной до 64 символов обрабатывается за несколько операций на символ текста.
+typedef struct myers_pattern
+{
+    uint64_t peq[TRIGRAM_ALPHABET];     // Позиции каждого символа в образце
+    uint64_t last;                      // Бит последнего символа образца
+    unsigned len;
+} myers_pattern;
+
+static void myers_init(myers_pattern *p, const unsigned char *pattern, size_t m) {
+    memset(p, 0, sizeof(*p));
+    for (size_t i = 0; i < m; i++) p->peq[pattern[i]] |= 1ULL << i;
+    p->last = 1ULL << (m - 1);
+    p->len = (unsigned)m;
+}
+
+static unsigned myers_distance(const myers_pattern *p, const unsigned char *text, size_t len) {
+    uint64_t pv = ~0ULL, mv = 0;
+    unsigned score = p->len, best = p->len;
+    for (size_t j = 0; j < len; j++) {
+        uint64_t eq = p->peq[text[j]];
+        uint64_t xv = eq | mv;
+        uint64_t xh = (((eq & pv) + pv) ^ pv) | eq;
+        uint64_t ph = mv | ~(xh | pv);
+        uint64_t mh = pv & xh;
+        if (ph & p->last) score++;
+        else if (mh & p->last) score--;
+        // Верхняя строка таблицы нулевая, поэтому в сдвиг не вносится перенос
+        ph <<= 1;
+        mh <<= 1;
+        pv = mh | ~(xv | ph);
+        mv = ph & xv;
+        if (score < best) best = score;
+    }
+    return best;
+}
+
+typedef struct fuzzy_match
+{
+    uint32_t id;
+    unsigned distance;
+} fuzzy_match;
+
+static int compare_matches(const void *a, const void *b) {
+    const fuzzy_match *x = (const fuzzy_match *)a, *y = (const fuzzy_match *)b;
+    if (x->distance != y->distance) return x->distance < y->distance ? -1 : 1;
+    return (x->id > y->id) - (x->id < y->id);
+}
+
+// Число опечаток по умолчанию в зависимости от длины образца
+unsigned fuzzy_default_distance(const char *pattern) {
+    size_t len = field_trim(pattern, strlen(pattern)).len;
+    return len < 5 ? 0 : len < 9 ? 1 : 2;
+}
+
+// Записи, в поле которых (0 - вкладчик, 1 - адвокат) образец встречается
+// не более чем с max_distance правками; упорядочены по числу правок и номеру.
+// Возвращает число найденных записей или -1 при нехватке памяти.
+long trigram_search(const trigram_index *idx, const record *DB, size_t total_records,
+                    int field, const char *pattern, unsigned max_distance, fuzzy_match **result) {
+    *result = NULL;
+    trigram_table_init();
+    unsigned char folded[DEPOSITOR_LEN], text[DEPOSITOR_LEN];
+    size_t pattern_len = strlen(pattern);
+    if (pattern_len > DEPOSITOR_LEN) pattern_len = DEPOSITOR_LEN;
+    size_t m = trigram_fold(pattern, pattern_len, folded);
+    if (m == 0) return 0;
+    myers_pattern myers;
+    myers_init(&myers, folded, m);
+
+    // Различные триграммы образца и порог совпадений для кандидата
+    uint32_t keys[DEPOSITOR_LEN];
+    size_t key_count = 0;
+    for (size_t i = 0; i + 3 <= m; i++) {
+        uint32_t key = trigram_key(field, folded + i);
+        size_t k = 0;
+        while (k < key_count && keys[k] != key) k++;
+        if (k == key_count) keys[key_count++] = key;
+    }
+    long threshold = (long)key_count - 3 * (long)max_distance;
+
+    uint32_t *candidates = NULL;
+    size_t candidate_count = 0;
+    unsigned char *hits = NULL;
+    fuzzy_match *matches = NULL;
+    long found = -1;
+    if (threshold > 0) {
+        size_t cap = 1024;
+        candidates = (uint32_t *)malloc(cap * sizeof(uint32_t));
+        hits = (unsigned char *)calloc(total_records ? total_records : 1, 1);
+        if (candidates == NULL || hits == NULL) goto done;
+        for (size_t k = 0; k < key_count; k++) {
+            const unsigned char *p = idx->postings + idx->offsets[keys[k]];
+            const unsigned char *end = idx->postings + idx->offsets[keys[k] + 1];
+            uint32_t next = 0;
+            while (p < end) {
+                uint32_t gap = 0;
+                for (int shift = 0; ; shift += 7) {
+                    gap |= (uint32_t)(*p & 0x7F) << shift;
+                    if (!(*p++ & 0x80)) break;
+                }
+                uint32_t id = next + gap;
+                next = id + 1;
+                if (id >= total_records) continue;
+                if (++hits[id] == threshold) {
+                    if (candidate_count == cap) {
+                        uint32_t *grown = (uint32_t *)realloc(candidates, cap * 2 * sizeof(uint32_t));
+                        if (grown == NULL) goto done;
+                        candidates = grown;
+                        cap *= 2;
+                    }
+                    candidates[candidate_count++] = id;
+                }
+            }
+        }
+    } else {
+        candidate_count = total_records;
+    }
+
+    matches = (fuzzy_match *)malloc((candidate_count ? candidate_count : 1) * sizeof(fuzzy_match));
+    if (matches == NULL) goto done;
+    found = 0;
+    for (size_t c = 0; c < candidate_count; c++) {
+        uint32_t id = candidates ? candidates[c] : (uint32_t)c;
+        size_t len = trigram_fold_field(&DB[id], field, text);
+        unsigned distance = myers_distance(&myers, text, len);
+        if (distance <= max_distance) {
+            matches[found].id = id;
+            matches[found].distance = distance;
             found++;
         }
     }
-    
-    if (found == 0) {
-        printf("Адвокатов с фамилией, начинающейся на \"%s\", не найдено.\n", search_prefix);
+    qsort(matches, (size_t)found, sizeof(fuzzy_match), compare_matches);
+    *result = matches;
+    matches = NULL;
+done:
+    free(matches);
+    free(hits);
+    free(candidates);
+    return found;
+}
+
+// Страница записей объединённого вида с позиции start: заголовок и до
+// PAGE_SIZE строк. Если columns построены, записи базы берутся из них.
+// Возвращает позицию за последней выведенной записью.
+size_t tb_page(text_buf *tb, const merged_view *view, const record_columns *columns, size_t start) {
+    size_t end = start + PAGE_SIZE;
+    if (end > merged_count(view)) end = merged_count(view);
+    tb_header(tb);
+    merged_pos pos = merged_locate(view, start);
+    for (size_t i = start; i < end; ++i)
+    {
+        uint32_t base_id;
+        const record *rec = merged_next(view, &pos, &base_id);
+        record row;
+        if (columns != NULL && columns->amount != NULL && base_id != UINT32_MAX) {
+            columns_row(columns, base_id, &row);
+            rec = &row;
+        }
+        tb_record(tb, rec);
+    }
+    return end;
+}
+
+// ---- Сервер запросов через локальный сокет ----
+// saod -S сокет [-t потоков] [файл] один раз отображает и упорядочивает базу
+// и считает итоги по адвокатам, а затем отвечает клиентам из пула потоков.
+// После запуска данные только читаются, поэтому потоки работают без
+// блокировок: каждый сам принимает соединение на общем сокете и обслуживает
+// клиента до отключения. Протокол строковый, каждый ответ (UTF-8)
+// заканчивается строкой ".":
+//   p N        - страница N (с 1) в порядке сортировки
+//   s префикс  - поиск по началу ФИО адвоката (UTF-8 или CP866)
+//   l          - итоги по адвокатам
+//   q          - закрыть соединение
+// saod -C сокет - клиент: команды со стандартного ввода, ответы на экран.
+
+#define SERVER_MIN_THREADS 4    // Клиентов, обслуживаемых одновременно
+#define SERVER_BACKLOG 64
+
+typedef struct query_server
+{
+    const merged_view *view;
+    const lawyer_report *report;
+    int listen_fd;
+} query_server;
+
+#ifndef _WIN32
+static int send_all(int fd, const char *data, size_t len) {
+    while (len > 0) {
+        ssize_t sent = send(fd, data, len, MSG_NOSIGNAL);
+        if (sent <= 0) return -1;
+        data += sent;
+        len -= (size_t)sent;
+    }
+    return 0;
+}
+
+// Ответ на одну строку запроса. Возвращает 0, если клиент закрывает соединение.
+static int server_answer(const query_server *srv, char *line, text_buf *tb) {
+    tb_clear(tb);
+    char command = line[0];
+    char *arg = line + (command ? 1 : 0);
+    while (*arg == ' ') arg++;
+
+    if (command == 'q') {
+        return 0;
+    } else if (command == 'p') {
+        size_t shown = merged_count(srv->view);
+        long max_page = shown ? (long)((shown - 1) / PAGE_SIZE) : 0;
+        long page = atol(arg) - 1;
+        if (page < 0) page = 0;
+        if (page > max_page) page = max_page;
+        size_t start = (size_t)page * PAGE_SIZE;
+        tb_printf(tb, "Страница %ld/%ld\n", page + 1, max_page + 1);
+        size_t end = tb_page(tb, srv->view, NULL, start);
+        tb_printf(tb, "\nПоказаны записи %zu–%zu из %zu\n", start + 1, end, shown);
+    } else if (command == 's' && *arg) {
+        utf8_to_cp866(arg);
+        tb_search_lawyer(tb, srv->view, arg);
+    } else if (command == 'l') {
+        tb_report(tb, srv->report);
     } else {
-        printf("\nНайдено записей: %d\n", found);
+        tb_printf(tb, "Команды: p N, s префикс, l, q\n");
+    }
+    tb_append(tb, ".\n", 2);
+    if (tb->failed) {
+        // Недособранный ответ не отправляется: клиент получает сообщение об ошибке
+        tb_clear(tb);
+        tb_printf(tb, "Недостаточно памяти для ответа\n.\n");
+    }
+    return 1;
+}
+
+static void *server_worker(void *arg) {
+    const query_server *srv = (const query_server *)arg;
+    text_buf tb = {0};
+    char line[256];
+    for (;;) {
+        int fd = accept(srv->listen_fd, NULL, NULL);
+        if (fd < 0) {
+            if (errno == EINTR || errno == ECONNABORTED) continue;
+            break;
+        }
+        int in_fd = dup(fd);
+        FILE *in = in_fd >= 0 ? fdopen(in_fd, "r") : NULL;
+        if (in == NULL && in_fd >= 0) close(in_fd);
+        while (in != NULL && fgets(line, sizeof(line), in) != NULL) {
+            line[strcspn(line, "\r\n")] = '\0';
+            if (!server_answer(srv, line, &tb)) break;
+            if (tb.failed || send_all(fd, tb.data, tb.len) != 0) break;
+        }
+        if (in != NULL) fclose(in);
+        close(fd);
+    }
+    tb_free(&tb);
+    return NULL;
+}
+
+static int unix_socket_address(struct sockaddr_un *addr, const char *path) {
+    memset(addr, 0, sizeof(*addr));
+    addr->sun_family = AF_UNIX;
+    if (strlen(path) >= sizeof(addr->sun_path)) return -1;
+    strcpy(addr->sun_path, path);
+    return 0;
+}
+#endif
+
+// Запускает сервер; возвращается только при ошибке сокета
+int run_server(const char *socket_path, const merged_view *view, const lawyer_report *report,
+               int thread_count) {
+#ifdef _WIN32
+    (void)socket_path; (void)view; (void)report; (void)thread_count;
+    return -1;
+#else
+    struct sockaddr_un addr;
+    if (unix_socket_address(&addr, socket_path) != 0) return -1;
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd < 0) return -1;
+    unlink(socket_path);    // Сокет, оставшийся от прошлого запуска
+    if (bind(fd, (struct sockaddr *)&addr, sizeof(addr)) != 0 || listen(fd, SERVER_BACKLOG) != 0) {
+        close(fd);
+        return -1;
+    }
+
+    if (thread_count < SERVER_MIN_THREADS) thread_count = SERVER_MIN_THREADS;
+    query_server *workers = (query_server *)malloc((size_t)thread_count * sizeof(query_server));
+    if (workers == NULL) {
+        close(fd);
+        unlink(socket_path);
+        return -1;
+    }
+    for (int t = 0; t < thread_count; t++) {
+        workers[t].view = view;
+        workers[t].report = report;
+        workers[t].listen_fd = fd;
+    }
+    printf("Сервер слушает %s, потоков: %d\n", socket_path, thread_count);
+    fflush(stdout);
+    run_tasks(server_worker, workers, sizeof(query_server), thread_count);
+    free(workers);
+    close(fd);
+    unlink(socket_path);
+    return -1;
+#endif
+}
+
+// Клиент: строки стандартного ввода уходят серверу, ответы до строки "."
+// выводятся на экран
+int run_client(const char *socket_path) {
+#ifdef _WIN32
+    (void)socket_path;
+    return -1;
+#else
+    struct sockaddr_un addr;
+    if (unix_socket_address(&addr, socket_path) != 0) return -1;
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd < 0) return -1;
+    if (connect(fd, (struct sockaddr *)&addr, sizeof(addr)) != 0) {
+        close(fd);
+        return -1;
+    }
+
+    int in_fd = dup(fd);
+    FILE *in = in_fd >= 0 ? fdopen(in_fd, "r") : NULL;
+    if (in == NULL) {
+        if (in_fd >= 0) close(in_fd);
+        close(fd);
+        return -1;
+    }
+
+    char line[256], buf[4096];
+    int result = 0;
+    while (result == 0 && read_line(line, sizeof(line)) == 0) {
+        strcat(line, "\n");
+        if (send_all(fd, line, strlen(line)) != 0) {
+            result = -1;
+            break;
+        }
+        if (line[0] == 'q') break;
+        // Ответ читается по строкам до строки "."
+        int line_start = 1;
+        for (;;) {
+            if (fgets(buf, sizeof(buf), in) == NULL) {
+                result = -1;
+                break;
+            }
+            if (line_start && strcmp(buf, ".\n") == 0) break;
+            fputs(buf, stdout);
+            line_start = buf[strlen(buf) - 1] == '\n';
+        }
+        fflush(stdout);
     }
+    fclose(in);
+    close(fd);
+    return result;
+#endif
 }
 
-int main()
+// Диалог ввода новой записи. Возвращает 0, если запись введена верно.
+int read_record(record *rec) {
+    char line[64];
+    printf("\nФИО вкладчика: ");
+    if (read_cp866_line(line, sizeof(line)) != 0) return -1;
+    fill_field(rec->depositor, sizeof(rec->depositor), line);
+
+    printf("Сумма вклада: ");
+    if (read_line(line, sizeof(line)) != 0) return -1;
+    long amount = atol(line);
+    if (amount < 0 || amount > 65535) return -1;
+    rec->amount = (unsigned short)amount;
+
+    printf("Дата (ДД-ММ-ГГ): ");
+    if (read_line(line, sizeof(line)) != 0) return -1;
+    if (parse_date(line) == NO_DATE) return -1;
+    fill_field(rec->date, sizeof(rec->date), line);
+
+    printf("ФИО адвоката: ");
+    if (read_cp866_line(line, sizeof(line)) != 0) return -1;
+    if (line[0] == '\0') return -1;
+    fill_field(rec->lawyer, sizeof(rec->lawyer), line);
+    return 0;
+}
+
+// Диалог ввода запроса: пустой ответ пропускает условие
+int read_query(record_query *q) {
+    char line[64];
+    query_init(q);
+
+    printf("\nПустой ввод - без условия.\n");
+    printf("Начало ФИО адвоката: ");
+    if (read_cp866_line(line, sizeof(line)) != 0) return -1;
+    snprintf(q->lawyer_prefix, sizeof(q->lawyer_prefix), "%.22s", line);
+
+    printf("Начало ФИО вкладчика: ");
+    if (read_cp866_line(line, sizeof(line)) != 0) return -1;
+    snprintf(q->depositor_prefix, sizeof(q->depositor_prefix), "%.30s", line);
+
+    printf("Дата с (ДД-ММ-ГГ): ");
+    if (read_line(line, sizeof(line)) != 0) return -1;
+    if (line[0]) {
+        q->date_from = parse_date(line);
+        if (q->date_from == NO_DATE) printf("Неверная дата, условие пропущено.\n");
+    }
+
+    printf("Дата по (ДД-ММ-ГГ): ");
+    if (read_line(line, sizeof(line)) != 0) return -1;
+    if (line[0]) {
+        q->date_to = parse_date(line);
+        if (q->date_to == NO_DATE) printf("Неверная дата, условие пропущено.\n");
+    }
+
+    printf("Сумма от: ");
+    if (read_line(line, sizeof(line)) != 0) return -1;
+    if (line[0]) q->amount_min = atol(line);
+
+    printf("Сумма до: ");
+    if (read_line(line, sizeof(line)) != 0) return -1;
+    if (line[0]) q->amount_max = atol(line);
+    return 0;
+}
+
+// ---- Генератор тестовой базы и замеры производительности ----
+// saod -G N файл [-l адвокатов] [-s зерно] пишет N случайных записей в том же
+// 64-байтном формате, что и testBase3.dat: ФИО в CP866, даты "ДД-ММ-ГГ",
+// суммы кратны 5000. По умолчанию на адвоката приходится около 400 вкладов,
+// как в учебной базе. saod -b N... генерирует базы указанных размеров во
+// временный файл (или берёт готовый файл, если аргумент не число) и меряет
+// загрузку, сортировку compare_records и radix_sort_order, поиск по префиксу
+// и построение страницы; для поиска и страниц выводятся медиана и 99-й
+// процентиль задержки.
+
+#define GEN_RECORDS_PER_LAWYER 400
+#define GEN_BLOCK_RECORDS 16384  // Записей в одном fwrite
+#define BENCH_QUERIES 2000
+
+static const char *const gen_surnames[] = {
+    "Власов", "Хасанов", "Архипов", "Глебов", "Патриков", "Янов", "Феофанов",
+    "Батыров", "Ахиллесов", "Поликарпов", "Ромуальдов", "Муамаров", "Кузнецов",
+    "Смирнов", "Соколов", "Лебедев", "Морозов", "Волков", "Зайцев", "Павлов",
+    "Семенов", "Голубев", "Виноградов", "Богданов", "Воробьев", "Федоров",
+    "Михайлов", "Беляев", "Тарасов", "Белов"
+};
+static const char *const gen_names[] = {
+    "Патрик", "Муамар", "Поликарп", "Ахиллес", "Батыр", "Ромуальд", "Феофан",
+    "Глеб", "Ян", "Архип", "Иван", "Петр", "Семен", "Федор", "Тарас", "Лев",
+    "Остап", "Назар", "Богдан", "Демьян"
+};
+static const char gen_initials[] = "АБВГДЕЖЗИЙКЛМНОПРСТУФХЦЧШЩЭЮЯ";
+
+#define GEN_SURNAMES (sizeof(gen_surnames) / sizeof(gen_surnames[0]))
+#define GEN_NAMES (sizeof(gen_names) / sizeof(gen_names[0]))
+#define GEN_INITIALS 29     // Букв в gen_initials (по 2 байта UTF-8)
+
+// xorshift64*: быстрый воспроизводимый генератор
+static uint64_t gen_next(uint64_t *state) {
+    uint64_t x = *state;
+    x ^= x >> 12;
+    x ^= x << 25;
+    x ^= x >> 27;
+    *state = x;
+    return x * 0x2545F4914F6CDD1DULL;
+}
+
+static unsigned gen_below(uint64_t *state, unsigned n) {
+    return (unsigned)((gen_next(state) >> 32) * n >> 32);
+}
+
+// Строковое поле записи из строки UTF-8
+static void gen_field(char *field, size_t field_len, const char *utf8) {
+    char buf[96];
+    snprintf(buf, sizeof(buf), "%s", utf8);
+    utf8_to_cp866(buf);
+    fill_field(field, field_len, buf);
+}
+
+// ФИО адвоката с номером id: фамилия и инициалы, разные для разных id
+static void gen_lawyer(char *field, unsigned id) {
+    char buf[64];
+    unsigned first = id % GEN_INITIALS, second = id / GEN_INITIALS % GEN_INITIALS;
+    snprintf(buf, sizeof(buf), "%s %.2s %.2s",
+             gen_surnames[id / (GEN_INITIALS * GEN_INITIALS) % GEN_SURNAMES],
+             gen_initials + 2 * first, gen_initials + 2 * second);
+    gen_field(field, LAWYER_LEN, buf);
+}
+
+int generate_database(const char *path, size_t count, unsigned lawyers, uint64_t seed) {
+    unsigned max_lawyers = (unsigned)(GEN_SURNAMES * GEN_INITIALS * GEN_INITIALS);
+    if (lawyers == 0) lawyers = (unsigned)(count / GEN_RECORDS_PER_LAWYER);
+    if (lawyers < 1) lawyers = 1;
+    if (lawyers > max_lawyers) lawyers = max_lawyers;
+
+    // Адвокаты выбираются из всего пространства имён, а не подряд
+    char (*lawyer_names)[LAWYER_LEN] = (char (*)[LAWYER_LEN])malloc(lawyers * (size_t)LAWYER_LEN);
+    record *buf = (record *)malloc(GEN_BLOCK_RECORDS * sizeof(record));
+    FILE *out = fopen(path, "wb");
+    int result = -1;
+    if (lawyer_names == NULL || buf == NULL || out == NULL) goto done;
+
+    uint64_t state = seed ? seed : 1;
+    unsigned step = 7919;   // Взаимно просто с max_lawyers
+    unsigned start = gen_below(&state, max_lawyers);
+    for (unsigned l = 0; l < lawyers; l++)
+        gen_lawyer(lawyer_names[l], (unsigned)((start + (uint64_t)l * step) % max_lawyers));
+
+    size_t done = 0;
+    while (done < count) {
+        size_t chunk = count - done < GEN_BLOCK_RECORDS ? count - done : GEN_BLOCK_RECORDS;
+        for (size_t i = 0; i < chunk; i++) {
+            record *rec = &buf[i];
+            char text[96];
+            const char *father = gen_names[gen_below(&state, GEN_NAMES)];
+            snprintf(text, sizeof(text), "%s %s %s%s",
+                     gen_surnames[gen_below(&state, GEN_SURNAMES)],
+                     gen_names[gen_below(&state, GEN_NAMES)], father, "ович");
+            gen_field(rec->depositor, sizeof(rec->depositor), text);
+            rec->amount = (unsigned short)(5000 * (1 + gen_below(&state, 10)));
+            snprintf(text, sizeof(text), "%02u-%02u-%02u", 1 + gen_below(&state, 28),
+                     1 + gen_below(&state, 12), 93 + gen_below(&state, 5));
+            gen_field(rec->date, sizeof(rec->date), text);
+            memcpy(rec->lawyer, lawyer_names[gen_below(&state, lawyers)], LAWYER_LEN);
+        }
+        if (fwrite(buf, sizeof(record), chunk, out) != chunk) goto done;
+        done += chunk;
+    }
+    result = 0;
+done:
+    if (out != NULL && fclose(out) != 0) result = -1;
+    if (result != 0 && out != NULL) remove(path);
+    free(buf);
+    free(lawyer_names);
+    return result;
+}
+
+// Монотонное время в наносекундах
+static uint64_t bench_now(void) {
+#ifdef _WIN32
+    LARGE_INTEGER freq, now;
+    QueryPerformanceFrequency(&freq);
+    QueryPerformanceCounter(&now);
+    return (uint64_t)((double)now.QuadPart * 1e9 / (double)freq.QuadPart);
+#else
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+#endif
+}
+
+static int compare_u64(const void *a, const void *b) {
+    uint64_t x = *(const uint64_t *)a, y = *(const uint64_t *)b;
+    return (x > y) - (x < y);
+}
+
+// Название замера, дополненное до 24 символов (printf считает байты UTF-8)
+static void bench_label(const char *what) {
+    size_t chars = 0;
+    for (const char *c = what; *c; c++)
+        if (((unsigned char)*c & 0xC0) != 0x80) chars++;
+    printf("  %s%*s", what, (int)(chars < 24 ? 24 - chars : 0), "");
+}
+
+// Медиана и 99-й процентиль задержек (массив сортируется)
+static void bench_latency(const char *what, uint64_t *ns, size_t count) {
+    qsort(ns, count, sizeof(uint64_t), compare_u64);
+    bench_label(what);
+    printf(" p50 %10.2f мкс   p99 %10.2f мкс\n", 
+           (double)ns[count / 2] / 1e3, (double)ns[count * 99 / 100] / 1e3);
+}
+
+static void bench_throughput(const char *what, uint64_t ns, size_t records) {
+    double seconds = (double)ns / 1e9;
+    bench_label(what);
+    printf(" %10.3f с   %12.0f записей/с   %8.1f МБ/с\n", seconds,
+           (double)records / seconds, (double)records * sizeof(record) / seconds / 1048576.0);
+}
+
+int run_benchmark(const char *path, int thread_count) {
+    uint64_t t0 = bench_now();
+    record_db db;
+    if (db_open(&db, path) != 0) return -1;
+    // Отображение ленивое: загрузкой считается первый проход по всем страницам
+    volatile unsigned long long checksum = 0;
+    for (size_t i = 0; i < db.count; i++) checksum += db.records[i].amount;
+    uint64_t load_ns = bench_now() - t0;
+
+    size_t n = db.count;
+    printf("%s: %zu записей\n", path, n);
+    if (n == 0 || n > UINT32_MAX) {
+        db_close(&db);
+        return n == 0 ? 0 : -1;
+    }
+    bench_throughput("Загрузка", load_ns, n);
+
+    uint32_t *order = (uint32_t *)malloc(n * sizeof(uint32_t));
+    uint32_t *check = (uint32_t *)malloc(n * sizeof(uint32_t));
+    uint64_t *ns = (uint64_t *)malloc(BENCH_QUERIES * sizeof(uint64_t));
+    text_buf page = {0};
+    int result = -1;
+    if (order == NULL || check == NULL || ns == NULL) goto done;
+
+    // Каждая сортировка начинает с тождественной перестановки, как при
+    // первом запуске: radix_sort_order читает записи в порядке order, и уже
+    // упорядоченный вход почти не обращался бы к словарю ФИО
+    for (size_t i = 0; i < n; i++) order[i] = (uint32_t)i;
+    sort_base = db.records;
+    t0 = bench_now();
+    qsort(order, n, sizeof(uint32_t), compare_order);
+    bench_throughput("qsort compare_records", bench_now() - t0, n);
+
+    for (size_t i = 0; i < n; i++) check[i] = (uint32_t)i;
+    t0 = bench_now();
+    if (radix_sort_order(db.records, check, n) != 0) goto done;
+    bench_throughput("radix_sort_order", bench_now() - t0, n);
+
+    // qsort неустойчива, поэтому с ней сравниваются ключи, а не номера
+    bench_label("qsort и radix");
+    for (size_t i = 0; i < n; i++) {
+        if (compare_records(&db.records[order[i]], &db.records[check[i]]) != 0) {
+            printf(" порядок различается!\n");
+            goto done;
+        }
+    }
+    printf(" порядок совпадает\n");
+
+    if (thread_count > 1) {
+        for (size_t i = 0; i < n; i++) order[i] = (uint32_t)i;
+        t0 = bench_now();
+        if (parallel_sort_order(db.records, order, n, thread_count) != 0) goto done;
+        bench_throughput("parallel_sort_order", bench_now() - t0, n);
+
+        // Сортировка в thread_count потоках и в одном должна дать одну перестановку
+        bench_label("-t 1 и -t N");
+        if (memcmp(check, order, n * sizeof(uint32_t)) != 0) {
+            printf(" перестановки различаются!\n");
+            goto done;
+        }
+        printf(" перестановки совпадают\n");
+    }
+
+    // Префиксы от 1 до 6 символов ФИО адвокатов случайных записей
+    uint64_t state = 0x9E3779B97F4A7C15ULL;
+    size_t found = 0;
+    for (size_t q = 0; q < BENCH_QUERIES; q++) {
+        const record *rec = &db.records[gen_below(&state, (unsigned)n)];
+        char prefix[LAWYER_LEN + 1];
+        size_t len = 1 + gen_below(&state, 6);
+        memcpy(prefix, rec->lawyer, len);
+        prefix[len] = '\0';
+        t0 = bench_now();
+        record_range range = find_lawyer_prefix(db.records, order, n, prefix);
+        ns[q] = bench_now() - t0;
+        found += range.end - range.begin;
+    }
+    bench_latency("Поиск по префиксу", ns, BENCH_QUERIES);
+    bench_label("Найдено");
+    printf(" %10.1f записей на запрос\n", (double)found / BENCH_QUERIES);
+
+    // Страница строится в буфер так же, как в пейджере, но не выводится
+    for (size_t q = 0; q < BENCH_QUERIES; q++) {
+        size_t first = gen_below(&state, (unsigned)n);
+        size_t last = first + PAGE_SIZE < n ? first + PAGE_SIZE : n;
+        t0 = bench_now();
+        tb_clear(&page);
+        tb_header(&page);
+        for (size_t i = first; i < last; i++) tb_record(&page, &db.records[order[i]]);
+        ns[q] = bench_now() - t0;
+    }
+    bench_latency("Построение страницы", ns, BENCH_QUERIES);
+
+    // Те же сортировка и поиск на сжатом хранилище
+    compact_store store;
+    t0 = bench_now();
+    int compact_result = compact_build(db.records, n, &store);
+    if (compact_result == 0) {
+        bench_throughput("Сжатие (.cdb)", bench_now() - t0, n);
+        bench_label("Размер");
+        printf(" %10.1f МБ -> %.1f МБ\n", (double)db.map.size / 1048576.0,
+               (double)compact_size(&store) / 1048576.0);
+        t0 = bench_now();
+        compact_result = compact_sort_order(&store, order);
+        bench_throughput("compact_sort_order", bench_now() - t0, n);
+        for (size_t q = 0; q < BENCH_QUERIES && compact_result == 0; q++) {
+            const record *rec = &db.records[gen_below(&state, (unsigned)n)];
+            char prefix[LAWYER_LEN + 1];
+            size_t len = 1 + gen_below(&state, 6);
+            memcpy(prefix, rec->lawyer, len);
+            prefix[len] = '\0';
+            t0 = bench_now();
+            compact_find_lawyer_prefix(&store, order, prefix);
+            ns[q] = bench_now() - t0;
+        }
+        if (compact_result == 0) bench_latency("Поиск по кодам", ns, BENCH_QUERIES);
+        compact_free(&store);
+    }
+    if (compact_result == -1) goto done;
+    result = 0;
+done:
+    tb_free(&page);
+    free(ns);
+    free(check);
+    free(order);
+    db_close(&db);
+    return result;
+}
+
+int main(int argc, char *argv[])
 {
-    // Устанавливаем кодировку консоли
-    system("chcp 866 > nul");
+    // Консоль в UTF-8, записи CP866 перекодируются при выводе
+    terminal_init();
     
-    FILE *fp;
-    fp = fopen("testBase3.dat", "rb");
+    // saod [-t потоков] [-r] [-c] [файл]
+    // saod [-m МБ] -x вход выход - внешняя сортировка файла
+    // saod -k [файл] - слить журнал добавленных записей с базой
+    // saod -g [-t потоков] [файл] - итоги по адвокатам без сортировки
+    // saod -G N файл [-l адвокатов] [-s зерно] - сгенерировать базу
+    // saod [-t потоков] -b N|файл... - замеры на базах из N записей или файлах
+    // saod -S сокет [-t потоков] [файл] - сервер запросов; saod -C сокет - клиент
+    // saod -E база файл.cdb / saod -D файл.cdb база - сжатая копия базы и обратно
+    const char *db_path = "testBase3.dat";
+    int compact = 0;
+    int group_batch = 0;
+    const char *gen_path = NULL;
+    size_t gen_count = 0;
+    unsigned gen_lawyers = 0;
+    uint64_t gen_seed = 1;
+    int bench_first = 0;
+    const char *server_path = NULL, *client_path = NULL;
+    const char *encode_in = NULL, *decode_in = NULL, *convert_out = NULL;
+    const char *external_in = NULL, *external_out = NULL;
+    size_t memory_mb = EXTERNAL_MEMORY_MB;
+    int thread_count = cpu_count();
+    int use_index = 1;
+    int use_columns = 0;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "-x") == 0 && i + 2 < argc) {
+            external_in = argv[++i];
+            external_out = argv[++i];
+        } else if (strcmp(argv[i], "-m") == 0 && i + 1 < argc) {
+            memory_mb = (size_t)atol(argv[++i]);
+            if (memory_mb < 1) memory_mb = 1;
+        } else if (strcmp(argv[i], "-t") == 0 && i + 1 < argc) {
+            thread_count = atoi(argv[++i]);
+            if (thread_count < 1) thread_count = 1;
+        } else if (strcmp(argv[i], "-r") == 0) {
+            use_index = 0;  // Сортировать заново, не читая и не сохраняя индекс
+        } else if (strcmp(argv[i], "-c") == 0) {
+            use_columns = 1;  // Колоночное представление в памяти
+        } else if (strcmp(argv[i], "-k") == 0) {
+            compact = 1;
+        } else if (strcmp(argv[i], "-g") == 0) {
+            group_batch = 1;
+        } else if (strcmp(argv[i], "-G") == 0 && i + 2 < argc) {
+            gen_count = (size_t)strtoull(argv[++i], NULL, 10);
+            gen_path = argv[++i];
+        } else if (strcmp(argv[i], "-l") == 0 && i + 1 < argc) {
+            gen_lawyers = (unsigned)atol(argv[++i]);
+        } else if (strcmp(argv[i], "-s") == 0 && i + 1 < argc) {
+            gen_seed = (uint64_t)strtoull(argv[++i], NULL, 10);
+        } else if (strcmp(argv[i], "-E") == 0 && i + 2 < argc) {
+            encode_in = argv[++i];
+            convert_out = argv[++i];
+        } else if (strcmp(argv[i], "-D") == 0 && i + 2 < argc) {
+            decode_in = argv[++i];
+            convert_out = argv[++i];
+        } else if (strcmp(argv[i], "-S") == 0 && i + 1 < argc) {
+            server_path = argv[++i];
+        } else if (strcmp(argv[i], "-C") == 0 && i + 1 < argc) {
+            client_path = argv[++i];
+        } else if (strcmp(argv[i], "-b") == 0) {
+            bench_first = i + 1;    // Все остальные аргументы - размеры или файлы
+            break;
+        } else {
+            db_path = argv[i];
+        }
+    }
+
+    if (encode_in != NULL || decode_in != NULL) {
+        int result = encode_in != NULL ? compact_encode_file(encode_in, convert_out)
+                                       : compact_decode_file(decode_in, convert_out);
+        if (result != 0) {
+            printf("Ошибка преобразования в %s!\n", convert_out);
+            return 1;
+        }
+        printf("Записано: %s\n", convert_out);
+        return 0;
+    }
+
+    if (client_path != NULL) {
+        if (run_client(client_path) != 0) {
+            printf("Нет связи с сервером %s!\n", client_path);
+            return 1;
+        }
+        return 0;
+    }
+
+    if (gen_path != NULL) {
+        if (generate_database(gen_path, gen_count, gen_lawyers, gen_seed) != 0) {
+            printf("Ошибка записи файла %s!\n", gen_path);
+            return 1;
+        }
+        printf("Сгенерировано записей: %zu (%s)\n", gen_count, gen_path);
+        return 0;
+    }
+
+    if (bench_first > 0) {
+        const char *bench_path = "saod_bench.tmp";
+        for (int i = bench_first; i < argc; i++) {
+            char *end;
+            size_t count = (size_t)strtoull(argv[i], &end, 10);
+            int generated = *end == '\0' && end != argv[i];
+            if (generated && generate_database(bench_path, count, 0, gen_seed) != 0) {
+                printf("Ошибка записи файла %s!\n", bench_path);
+                return 1;
+            }
+            int result = run_benchmark(generated ? bench_path : argv[i], thread_count);
+            if (generated) remove(bench_path);
+            if (result != 0) {
+                printf("Ошибка замера %s!\n", argv[i]);
+                return 1;
+            }
+        }
+        return 0;
+    }
+
+    if (external_in != NULL) {
+        if (external_sort(external_in, external_out, memory_mb) != 0) {
+            printf("Ошибка внешней сортировки!\n");
+            return 1;
+        }
+        printf("Отсортированный файл записан: %s\n", external_out);
+        return 0;
+    }
+
+    if (compact) {
+        if (compact_database(db_path, memory_mb) != 0) {
+            printf("Ошибка уплотнения базы!\n");
+            return 1;
+        }
+        printf("Журнал добавленных записей слит с базой %s\n", db_path);
+        return 0;
+    }
 
-    if (fp == NULL) {
+    record_db db;
+    if (db_open(&db, db_path) != 0) {
         printf("Ошибка открытия файла!\n");
         return 1;
     }
 
-    record DB[4000] = {0};
-    int total_records = fread(DB, sizeof(record), 4000, fp);
-    fclose(fp);
+    const record *DB = db.records;
+    size_t total_records = db.count;
+    if (total_records > UINT32_MAX) {
+        printf("Слишком много записей: %zu\n", total_records);
+        db_close(&db);
+        return 1;
+    }
+
+    printf("Загружено записей: %zu\n", total_records);
+
+    if (group_batch) {
+        lawyer_report report;
+        int result = aggregate_lawyers(NULL, DB, total_records, thread_count, &report);
+        if (result == 0) print_report(&report);
+        else printf("Недостаточно памяти!\n");
+        report_free(&report);
+        db_close(&db);
+        return result == 0 ? 0 : 1;
+    }
+
+    // Готовый индекс отображается вместо сортировки
+    file_map index_map;
+    const uint32_t *order = NULL;
+    uint32_t *sorted = NULL;
+    if (use_index && index_open(&index_map, db_path, &db, &order) == 0) {
+        printf("Используется сохранённый индекс %s.idx\n", db_path);
+    } else {
+        sorted = (uint32_t *)malloc((total_records ? total_records : 1) * sizeof(uint32_t));
+        if (sorted == NULL) {
+            printf("Недостаточно памяти!\n");
+            db_close(&db);
+            return 1;
+        }
+        for (size_t i = 0; i < total_records; i++) sorted[i] = (uint32_t)i;
+
+        // СОРТИРОВКА по ФИО адвоката и сумме вклада
+        if (records_sorted(DB, total_records)) {
+            printf("Файл уже отсортирован.\n");
+        } else {
+            printf("Сортируем данные по ФИО адвоката и сумме вклада...\n");
+            if (parallel_sort_order(DB, sorted, total_records, thread_count) != 0) {
+                sort_base = DB;
+                qsort(sorted, total_records, sizeof(uint32_t), compare_order);
+            }
+            printf("Сортировка завершена.\n");
+        }
+        if (use_index && index_save(db_path, &db, sorted) != 0)
+            printf("Не удалось сохранить индекс %s.idx\n", db_path);
+        order = sorted;
+    }
 
-    printf("Загружено записей: %d\n", total_records);
+    secondary_indexes secondary;
+    secondary_init(&secondary, DB, total_records);
+
+    record_columns columns = {0};
+    if (use_columns && columns_build(&columns, DB, total_records) != 0)
+        printf("Недостаточно памяти для колоночного представления!\n");
+
+    delta_log delta;
+    if (delta_load(&delta, db_path) != 0)
+        printf("Не удалось прочитать журнал добавленных записей!\n");
+    else if (delta.count > 0)
+        printf("Добавленных записей в журнале: %zu\n", delta.count);
+    merged_view view = {DB, order, total_records, &delta};
+
+    if (server_path != NULL) {
+        // Итоги не меняются, пока сервер работает, и считаются один раз
+        lawyer_report report;
+        int result = aggregate_lawyers(&view, NULL, 0, thread_count, &report);
+        if (result == 0) result = run_server(server_path, &view, &report, thread_count);
+        printf("Ошибка сервера на сокете %s!\n", server_path);
+        report_free(&report);
+        delta_free(&delta);
+        columns_free(&columns);
+        secondary_free(&secondary);
+        if (sorted != NULL)
+            free(sorted);
+        else
+            unmap_file(&index_map);
+        db_close(&db);
+        return 1;
+    }
 
-    // СОРТИРОВКА по ФИО адвоката и сумме вклада
-    printf("Сортируем данные по ФИО адвоката и сумме вклада...\n");
-    qsort(DB, total_records, sizeof(record), compare_records);
-    printf("Сортировка завершена.\n");
+    // Триграммный индекс открывается или строится при первом нечётком поиске
+    trigram_index trigrams;
+    int trigrams_ready = 0;
 
-    int page = 0;
+    long page = 0;
     char command;
-    int max_page = (total_records - 1) / PAGE_SIZE;
 
+    result_cache cache;
+    cache_init(&cache);
+    text_buf screen = {0}, answer = {0};
     do {
-        system("cls");
-        
-        int start = page * PAGE_SIZE;
-        int end = start + PAGE_SIZE;
-        if (end > total_records) end = total_records;
-        
-        system("chcp 65001 > nul");
-        printf("Страница %d/%d\n", page + 1, max_page + 1);
-        printf("%-30s             %-6s    %-10s   %-22s\n", 
-               "ФИО вкладчика", "Сумма", "Дата", "Адвокат");
-        printf("-------------------------------------------------------------------------------\n");
-        
-        system("chcp 866 > nul");
-        for (int i = start; i < end; ++i)
-        {
-            printf("%-30s %-6hu %-10s %-22s\n", 
-                   DB[i].depositor, 
-                   DB[i].amount, 
-                   DB[i].date, 
-                   DB[i].lawyer);
-        }
-        
-        system("chcp 65001 > nul");
-        printf("\nПоказаны записи %d–%d из %d\n", start + 1, end, total_records);
-        printf("Команды: [n] +1  [p] -1  [N] +10  [P] -10  [s] поиск  [q] выход: ");
-        command = getchar();
-
-        // Очистить буфер ввода
-        while (getchar() != '\n');
-        system("chcp 866 > nul");
-
-        
-if (command == 'n') {  // следующая страница (+1)
+        cache_validate(&cache, db_path, delta.count, columns.amount != NULL);
+        size_t shown = merged_count(&view);
+        long max_page = shown ? (long)((shown - 1) / PAGE_SIZE) : 0;
+        if (page > max_page) page = max_page;
+        size_t start = (size_t)page * PAGE_SIZE;
+        size_t end = start + PAGE_SIZE;
+        if (end > shown) end = shown;
+
+        // Вся страница собирается в буфер и выводится одним вызовом;
+        // уже собранные страницы берутся из кэша
+        char key[CACHE_KEY_LEN];
+        snprintf(key, sizeof(key), "p %ld", page);
+        const cache_entry *hit = cache_get(&cache, key);
+        if (hit == NULL) {
+            tb_clear(&answer);
+            tb_printf(&answer, "Страница %ld/%ld\n", page + 1, max_page + 1);
+            tb_page(&answer, &view, &columns, start);
+            tb_printf(&answer, "\nПоказаны записи %zu–%zu из %zu\n", start + 1, end, shown);
+            record_range range = {start, end};
+            cache_put(&cache, key, &answer, range);
+        }
+        tb_append(&screen, ANSI_CLEAR, strlen(ANSI_CLEAR));
+        tb_append_buf(&screen, hit != NULL ? &hit->text : &answer);
+        tb_printf(&screen, "Команды: [n] +1  [p] -1  [N] +10  [P] -10  [s] поиск  [f] фильтр  [t] топ  [g] подстрока  [z] нечёткий  [i] сводка  [l] итоги  [c] кэш  [a] добавить  [q] выход: ");
+        tb_flush(&screen);
+
+        command = (char)read_command();
+
+        if (command == 'n') {  // следующая страница (+1)
             if (page < max_page)
                 page++;
         }
@@ -141,21 +4194,208 @@ if (command == 'n') {  // следующая страница (+1)
             if (page < 0) page = 0;
         }
         else if (command == 's' || command == 'S') {
-            // Поиск по первым трем буквам фамилии адвоката
-            system("chcp 65001 > nul");
-            printf("\nВведите первые 3 буквы фамилии адвоката для поиска: ");
-            char search_prefix[4];
-            scanf("%3s", search_prefix);
-            while (getchar() != '\n'); // Очистка буфера
-            
-            system("chcp 866 > nul");
-            search_by_lawyer_prefix(DB, total_records, search_prefix);
+            // Поиск по началу ФИО адвоката (любой длины)
+            printf("\nВведите начало фамилии адвоката для поиска: ");
+            char search_prefix[64];
+            if (read_cp866_line(search_prefix, sizeof(search_prefix)) != 0) break;
             
+            // Первая страница кэшируется пейджером курсора вместе с диапазоном
+            char key[sizeof(search_prefix) + 2];
+            snprintf(key, sizeof(key), "s %s", search_prefix);
+            const cache_entry *known = cache_peek(&cache, key);
+            record_range range = known != NULL ? known->range : merged_lawyer_range(&view, search_prefix);
+            result_cursor cursor;
+            cursor_range(&cursor, &view, range);
+            browse_cursor(&cursor, "Поиск по адвокату", search_prefix, &cache, key);
+            cursor_free(&cursor);
+
+            // Переходим на страницу с первой найденной записью
+            if (range.begin < range.end)
+                page = (long)(range.begin / PAGE_SIZE);
+        }
+        else if (command == 'f' || command == 'F') {
+            // Запрос по нескольким полям через вторичные индексы
+            record_query query;
+            if (read_query(&query) != 0) break;
+
+            uint32_t *found = NULL;
+            long found_count;
+            if (columns.amount != NULL && !query.lawyer_prefix[0] && !query.depositor_prefix[0]) {
+                // Только сумма и дата: просмотр колонок без построения индексов
+                found = (uint32_t *)malloc((total_records ? total_records : 1) * sizeof(uint32_t));
+                found_count = found ? (long)columns_filter(&columns, &query, found) : -1;
+            } else {
+                found_count = query_run(&secondary, order, &query, &found);
+            }
+            if (found_count < 0) {
+                free(found);
+                printf("Недостаточно памяти для построения индекса!\n");
+                printf("\nНажмите Enter для продолжения...");
+                read_command();
+            } else {
+                result_cursor cursor;
+                cursor_ids(&cursor, DB, found, (size_t)found_count);
+                browse_cursor(&cursor, "Запрос", NULL, NULL, NULL);
+                cursor_free(&cursor);
+            }
+        }
+        else if (command == 't' || command == 'T') {
+            // k наибольших или наименьших записей по сумме или дате
+            char field_answer[8], side_answer[8], line[32];
+            printf("\nУпорядочить по [s] сумме или [d] дате: ");
+            if (read_line(field_answer, sizeof(field_answer)) != 0) break;
+            printf("[b] наибольшие или [m] наименьшие: ");
+            if (read_line(side_answer, sizeof(side_answer)) != 0) break;
+            printf("Сколько записей: ");
+            if (read_line(line, sizeof(line)) != 0) break;
+            long k = atol(line);
+            record_query query;
+            printf("Условия отбора.");
+            if (read_query(&query) != 0) break;
+
+            int by_date = field_answer[0] == 'd' || field_answer[0] == 'D';
+            int largest = side_answer[0] != 'm' && side_answer[0] != 'M';
+            uint32_t *found = NULL;
+            long found_count = query_top(&secondary, order, &query, by_date, largest,
+                                         k > 0 ? (size_t)k : 0, &found);
+            if (found_count < 0) {
+                free(found);
+                printf("Недостаточно памяти для построения индекса!\n");
+                printf("\nНажмите Enter для продолжения...");
+                read_command();
+            } else {
+                result_cursor cursor;
+                cursor_ids(&cursor, DB, found, (size_t)found_count);
+                browse_cursor(&cursor, by_date ? (largest ? "Самые поздние" : "Самые ранние")
+                                               : (largest ? "Наибольшие суммы" : "Наименьшие суммы"), NULL,
+                               NULL, NULL);
+                cursor_free(&cursor);
+            }
+        }
+        else if (command == 'g' || command == 'G') {
+            // Поиск подстроки в ФИО без индекса (полный просмотр SIMD)
+            char field_answer[8], pattern[64];
+            printf("\nИскать в ФИО [a] адвоката или [v] вкладчика: ");
+            if (read_line(field_answer, sizeof(field_answer)) != 0) break;
+            printf("Подстрока: ");
+            if (read_cp866_line(pattern, sizeof(pattern)) != 0) break;
+
+            // База просматривается лениво, по мере листания результатов
+            scan_pattern scan;
+            if (scan_pattern_init(&scan, field_answer[0] == 'a' || field_answer[0] == 'A', pattern, 1) == 0) {
+                result_cursor cursor;
+                cursor_scan(&cursor, DB, total_records, &scan);
+                browse_cursor(&cursor, "Подстрока", pattern, NULL, NULL);
+                cursor_free(&cursor);
+            }
+        }
+        else if (command == 'z' || command == 'Z') {
+            // Нечёткий поиск по фрагменту ФИО через триграммный индекс
+            char field_answer[8], pattern[64], distance_answer[8];
+            printf("\nИскать в ФИО [a] адвоката или [v] вкладчика: ");
+            if (read_line(field_answer, sizeof(field_answer)) != 0) break;
+            printf("Фрагмент ФИО: ");
+            if (read_cp866_line(pattern, sizeof(pattern)) != 0) break;
+            printf("Допустимо опечаток (Enter - %u): ", fuzzy_default_distance(pattern));
+            if (read_line(distance_answer, sizeof(distance_answer)) != 0) break;
+            unsigned max_distance = distance_answer[0] ? (unsigned)atoi(distance_answer)
+                                                       : fuzzy_default_distance(pattern);
+
+            if (!trigrams_ready && trigram_open(&trigrams, db_path, &db) == 0) {
+                trigrams_ready = 1;
+            } else if (!trigrams_ready) {
+                printf("Строится триграммный индекс...\n");
+                if (trigram_build(DB, total_records, &trigrams) == 0) {
+                    trigrams_ready = 1;
+                    if (trigram_save(db_path, &db, &trigrams) != 0)
+                        printf("Не удалось сохранить %s.tri\n", db_path);
+                }
+            }
+
+            fuzzy_match *matches = NULL;
+            long found_count = -1;
+            if (trigrams_ready)
+                found_count = trigram_search(&trigrams, DB, total_records,
+                                             field_answer[0] == 'a' || field_answer[0] == 'A',
+                                             pattern, max_distance, &matches);
+            // Номера записей по возрастанию числа опечаток
+            uint32_t *found = (uint32_t *)malloc((found_count > 0 ? (size_t)found_count : 1) * sizeof(uint32_t));
+            if (found == NULL) found_count = -1;
+            for (long i = 0; i < found_count; i++) found[i] = matches[i].id;
+            free(matches);
+
+            if (found_count < 0) {
+                free(found);
+                printf("Недостаточно памяти!\n");
+                printf("\nНажмите Enter для продолжения...");
+                read_command();
+            } else {
+                result_cursor cursor;
+                cursor_ids(&cursor, DB, found, (size_t)found_count);
+                browse_cursor(&cursor, "Нечёткий поиск", pattern, NULL, NULL);
+                cursor_free(&cursor);
+            }
+        }
+        else if (command == 'l' || command == 'L') {
+            // Итоги по адвокатам по упорядоченному виду
+            lawyer_report report;
+            if (aggregate_lawyers(&view, NULL, 0, thread_count, &report) == 0)
+                print_report(&report);
+            else
+                printf("Недостаточно памяти!\n");
+            report_free(&report);
+            printf("\nНажмите Enter для продолжения...");
+            read_command();
+        }
+        else if (command == 'a' || command == 'A') {
+            // Добавление записи в журнал без пересортировки базы
+            record rec;
+            if (read_record(&rec) != 0)
+                printf("Неверные данные, запись не добавлена.\n");
+            else if (delta_append(&delta, db_path, &rec) != 0)
+                printf("Не удалось записать журнал!\n");
+            else
+                printf("Запись добавлена. Фильтры и сводка увидят её после уплотнения (-k).\n");
+            printf("\nНажмите Enter для продолжения...");
+            read_command();
+        }
+        else if (command == 'c' || command == 'C') {
+            print_cache_stats(&cache);
+            printf("\nНажмите Enter для продолжения...");
+            read_command();
+        }
+        else if (command == 'i' || command == 'I') {
+            // Сводка по суммам и датам через колоночное представление
+            if (columns.amount == NULL && columns_build(&columns, DB, total_records) != 0) {
+                printf("Недостаточно памяти для колоночного представления!\n");
+            } else {
+                columns_summary summary;
+                char first[10], last[10];
+                columns_summarize(&columns, &summary);
+                day_to_date(summary.first_day, first);
+                day_to_date(summary.last_day, last);
+                printf("\nЗаписей: %zu\n", total_records);
+                printf("Сумма вкладов: %llu\n", (unsigned long long)summary.total);
+                printf("Вклад: от %u до %u\n", summary.min_amount, summary.max_amount);
+                printf("Даты: с %s по %s\n", first, last);
+            }
             printf("\nНажмите Enter для продолжения...");
-            getchar();
+            read_command();
         }
 
     } while (command != 'q' && command != 'Q');
 
+    tb_free(&screen);
+    tb_free(&answer);
+    cache_clear(&cache);
+    if (trigrams_ready) trigram_free(&trigrams);
+    delta_free(&delta);
+    columns_free(&columns);
+    secondary_free(&secondary);
+    if (sorted != NULL)
+        free(sorted);
+    else
+        unmap_file(&index_map);
+    db_close(&db);
     return 0;
 }
\ No newline at end of file